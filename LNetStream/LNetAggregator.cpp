@@ -0,0 +1,215 @@
+#include "LNetAggregator.hpp"
+#include "LNetMessage.hpp"
+
+namespace lnet
+{
+	Aggregator::Aggregator() :
+		maxContainerSize(0),
+		containersInUse(0)
+	{ }
+
+	// Biggest container packet in bytes, 0 sends every message in its own packet (any thread)
+
+	void Aggregator::setMaxContainerSize(const size_t size)
+	{
+		maxContainerSize.store(size, std::memory_order_relaxed);
+	}
+
+	size_t Aggregator::getMaxContainerSize() const
+	{
+		return maxContainerSize.load(std::memory_order_relaxed);
+	}
+
+	// Whether the packet is small enough to go in a container
+
+	bool Aggregator::accepts(const ENetPacket* packet) const
+	{
+		const size_t limit = getMaxContainerSize();
+
+		return packet->dataLength <= LNET_MAX_AGGREGATED_SIZE &&
+			LNET_TYPE_SIZE + LNET_MAX_LENGTH_SIZE + packet->dataLength <= limit;
+	}
+
+	// Copy the packet's message into the peer's container for the channel, the packet stays the caller's
+
+	void Aggregator::add(ENetPeer* peer, const LNetByte& channel, const ENetPacket* packet)
+	{
+		const enet_uint32 flags = packet->flags & LNET_DELIVERY_FLAGS;
+
+		auto result = openContainers.try_emplace(keyOf(peer, channel), containersInUse);
+		if (result.second)
+		{
+			if (containersInUse == containers.size())
+			{
+				containers.emplace_back();
+			}
+
+			Container& container = containers[containersInUse++];
+			container.peer = peer;
+			container.channel = channel;
+			container.flags = flags;
+		}
+
+		Container& container = containers[result.first->second];
+
+		// Delivered differently, what was packed before it leaves first so the channel keeps its order
+		if (container.flags != flags)
+		{
+			send(container);
+			container.flags = flags;
+		}
+
+		// No room left, send what it has and start over
+		if (LNET_TYPE_SIZE + container.data.size() + LNET_MAX_LENGTH_SIZE + packet->dataLength > getMaxContainerSize())
+		{
+			send(container);
+		}
+
+		LNetByte lengthBytes[LNET_MAX_LENGTH_SIZE];
+		size_t lengthSize = writeLength(lengthBytes, packet->dataLength);
+
+		if (container.messageCount == 0)
+		{
+			container.firstMessageOffset = lengthSize;
+		}
+
+		container.data.insert(container.data.end(), lengthBytes, lengthBytes + lengthSize);
+		container.data.insert(container.data.end(), packet->data, packet->data + packet->dataLength);
+		container.messageCount++;
+	}
+
+	// Send every container
+
+	void Aggregator::flush()
+	{
+		for (size_t index = 0; index < containersInUse; index++)
+		{
+			send(containers[index]);
+		}
+
+		containersInUse = 0;
+		openContainers.clear();
+	}
+
+	// Drop the containers of a peer that disconnected
+
+	void Aggregator::discard(const ENetPeer* peer)
+	{
+		for (size_t index = 0; index < containersInUse; index++)
+		{
+			if (containers[index].peer == peer)
+			{
+				containers[index].data.clear();
+				containers[index].messageCount = 0;
+				containers[index].peer = nullptr;
+			}
+		}
+
+		// Its slot may be given to a new peer before the next flush
+		for (auto it = openContainers.begin(); it != openContainers.end();)
+		{
+			if (containers[it->second].peer == nullptr)
+			{
+				it = openContainers.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+
+	// Write a message size, returns the bytes used (at most LNET_MAX_LENGTH_SIZE)
+
+	size_t Aggregator::writeLength(LNetByte* destination, size_t length)
+	{
+		size_t used = 0;
+
+		while (length >= 0x80)
+		{
+			destination[used++] = static_cast<LNetByte>(length | 0x80);
+			length >>= 7;
+		}
+		destination[used++] = static_cast<LNetByte>(length);
+
+		return used;
+	}
+
+	// Read a message size, returns the bytes used, 0 when it is cut or too long
+
+	size_t Aggregator::readLength(const LNetByte* data, const size_t available, size_t& length)
+	{
+		length = 0;
+
+		for (size_t used = 0; used < available && used < LNET_MAX_LENGTH_SIZE; used++)
+		{
+			length |= static_cast<size_t>(data[used] & 0x7F) << (7 * used);
+
+			if (!(data[used] & 0x80))
+			{
+				return used + 1;
+			}
+		}
+
+		return 0;
+	}
+
+	/// <summary>
+	/// Send the container's packet and empty it
+	/// </summary>
+	/// <param name="container"></param>
+
+	void Aggregator::send(Container& container)
+	{
+		if (container.messageCount == 0)
+		{
+			return;
+		}
+
+		ENetPacket* packet;
+
+		// A lone message doesn't need the container around it
+		if (container.messageCount == 1)
+		{
+			packet = enet_packet_create(container.data.data() + container.firstMessageOffset,
+				container.data.size() - container.firstMessageOffset, container.flags);
+		}
+		else
+		{
+			packet = enet_packet_create(nullptr, LNET_TYPE_SIZE + container.data.size(), container.flags);
+
+			if (packet)
+			{
+				LNet2Byte netType = LNetEndiannessHandler::toNetworkEndian(LNET_TYPE_CONTAINER);
+				std::memcpy(packet->data, &netType, LNET_TYPE_SIZE);
+				std::memcpy(packet->data + LNET_TYPE_SIZE, container.data.data(), container.data.size());
+			}
+		}
+
+		container.data.clear();
+		container.messageCount = 0;
+
+		if (!packet)
+		{
+			throw std::runtime_error("Couldn't create packet.");
+		}
+
+		if (enet_peer_send(container.peer, container.channel, packet) < 0)
+		{
+			enet_packet_destroy(packet);
+		}
+	}
+
+	/// <summary>
+	/// Key of the container for a peer and channel
+	/// </summary>
+	/// <param name="peer"></param>
+	/// <param name="channel"></param>
+	/// <returns></returns>
+
+	uint64_t Aggregator::keyOf(const ENetPeer* peer, const LNetByte& channel)
+	{
+		// incomingPeerID is the peer's index in its host
+		return (static_cast<uint64_t>(peer->incomingPeerID) << 8) | channel;
+	}
+}
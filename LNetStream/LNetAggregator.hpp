@@ -0,0 +1,101 @@
+#ifndef LNET_AGGREGATOR_HPP
+#define LNET_AGGREGATOR_HPP
+
+#include <enet/enet.h>
+#include <atomic>
+#include <unordered_map>
+#include <vector>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// Container size setAggregation() uses when given none, stays under enet's default MTU (1392) with room for enet's own headers.
+	// Aggregation itself is off until it is set, containers change what goes on the wire and both ends have to know them
+	constexpr size_t LNET_DEFAULT_CONTAINER_SIZE = 1200;
+
+	// Messages bigger than this are always sent in their own packet
+	constexpr size_t LNET_MAX_AGGREGATED_SIZE = 256;
+
+	// Bytes of a message size inside a container (7 bits each, enough for any container)
+	constexpr size_t LNET_MAX_LENGTH_SIZE = 3;
+
+	// Packet flags that change how enet delivers a packet, containers only hold messages sent with the same ones.
+	// A message with other flags sends the peer's container for the channel first, so the channel keeps its order
+	constexpr enet_uint32 LNET_DELIVERY_FLAGS = ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+
+	// Packs the small messages sent to a peer on the same channel into container packets, until flush() sends them.
+	// A container is [LNET_TYPE_CONTAINER] then, for every message, its size (7 bits per byte, high bit = more)
+	// and its network form; a container holding a single message is sent as that message alone.
+	// Everything but setMaxContainerSize runs on the thread owning the host
+	class Aggregator
+	{
+	public:
+		Aggregator();
+
+		Aggregator(const Aggregator&) = delete;
+		Aggregator& operator=(const Aggregator&) = delete;
+
+		// Biggest container packet in bytes, 0 sends every message in its own packet (any thread)
+		void setMaxContainerSize(const size_t size);
+		size_t getMaxContainerSize() const;
+
+		// Whether the packet is small enough to go in a container
+		bool accepts(const ENetPacket* packet) const;
+
+		// Copy the packet's message into the peer's container for the channel, the packet stays the caller's
+		void add(ENetPeer* peer, const LNetByte& channel, const ENetPacket* packet);
+
+		// Send every container
+		void flush();
+
+		// Drop the containers of a peer that disconnected
+		void discard(const ENetPeer* peer);
+
+		// Write a message size, returns the bytes used (at most LNET_MAX_LENGTH_SIZE)
+		static size_t writeLength(LNetByte* destination, size_t length);
+
+		// Read a message size, returns the bytes used, 0 when it is cut or too long
+		static size_t readLength(const LNetByte* data, const size_t available, size_t& length);
+
+	private:
+
+		struct Container
+		{
+			ENetPeer* peer = nullptr;
+			LNetByte channel = 0;
+			enet_uint32 flags = 0;
+
+			// Size prefixed messages
+			std::vector<LNetByte> data;
+			size_t messageCount = 0;
+			size_t firstMessageOffset = 0;
+		};
+
+		/// <summary>
+		/// Send the container's packet and empty it
+		/// </summary>
+		/// <param name="container"></param>
+		void send(Container& container);
+
+		/// <summary>
+		/// Key of the container for a peer and channel
+		/// </summary>
+		/// <param name="peer"></param>
+		/// <param name="channel"></param>
+		/// <returns></returns>
+		static uint64_t keyOf(const ENetPeer* peer, const LNetByte& channel);
+
+	private:
+
+		std::atomic<size_t> maxContainerSize;
+
+		// Containers in use come first, the rest keep their buffers for the next flush
+		std::vector<Container> containers;
+		size_t containersInUse;
+
+		// key -> index in containers
+		std::unordered_map<uint64_t, size_t> openContainers;
+	};
+}
+
+#endif
@@ -0,0 +1,278 @@
+#ifndef LNET_ASIO_SERVICE_HPP
+#define LNET_ASIO_SERVICE_HPP
+
+#include <asio.hpp>
+#include <enet/enet.h>
+#include <enet/time.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// Longest the service waits without traffic or an enet deadline (milliseconds)
+	constexpr LNet4Byte LNET_DEFAULT_ASIO_MAX_WAIT = 250;
+
+	// Services a Server or Client from an asio io_context instead of polling tick():
+	// tick() runs when the enet socket is readable, when enet's next resend or ping is due, and soon after a send.
+	// Handlers run on a strand, so the io_context can be run by several threads (the same ones serving asio sockets).
+	// Header only, include it where asio is available (needs asio 1.20+ for giving the socket back to enet)
+	template<typename Endpoint>
+	class AsioService
+	{
+	public:
+		AsioService(asio::io_context& context, Endpoint& endpoint, const LNet4Byte& maxWait = LNET_DEFAULT_ASIO_MAX_WAIT);
+
+		AsioService(const AsioService&) = delete;
+		AsioService& operator=(const AsioService&) = delete;
+
+		// Start servicing, after listen()/connect(), without a network thread
+		void start();
+
+		// Stop servicing and give the socket back to enet, call it on the io_context (or once it stopped running)
+		// and let the cancelled handlers run before destroying the service
+		void stop();
+
+		// Service soon, any thread (cheap when a service is already on its way)
+		void wake();
+
+		~AsioService();
+
+	private:
+
+		/// <summary>
+		/// Wait for the enet socket to have a datagram
+		/// </summary>
+		void waitReadable();
+
+		/// <summary>
+		/// Wait until enet's next deadline (at most maxWait)
+		/// </summary>
+		void armTimer();
+
+		/// <summary>
+		/// Tick the endpoint, then wait for its next deadline
+		/// </summary>
+		void service();
+
+		/// <summary>
+		/// Milliseconds until enet has something to do without traffic: a resend, a ping, the bandwidth throttle
+		/// </summary>
+		/// <param name="host"></param>
+		/// <param name="maxWait"></param>
+		/// <returns></returns>
+		static LNet4Byte timeUntilNextDeadline(const ENetHost* host, const LNet4Byte& maxWait);
+
+	private:
+
+		Endpoint& endpoint;
+		ENetHost* host;
+		LNet4Byte maxWait;
+
+		asio::strand<asio::io_context::executor_type> strand;
+
+		// enet's own socket, enet keeps reading and writing it
+		asio::ip::udp::socket socket;
+		asio::steady_timer timer;
+
+		std::atomic<bool> running;
+		std::atomic<bool> servicePending;
+	};
+
+
+	template<typename Endpoint>
+	AsioService<Endpoint>::AsioService(asio::io_context& context, Endpoint& endpoint, const LNet4Byte& maxWait) :
+		endpoint(endpoint),
+		host(nullptr),
+		maxWait(maxWait),
+		strand(asio::make_strand(context)),
+		socket(context),
+		timer(context),
+		running(false),
+		servicePending(false)
+	{ }
+
+	// Start servicing, after listen()/connect(), without a network thread
+
+	template<typename Endpoint>
+	void AsioService<Endpoint>::start()
+	{
+		host = endpoint.getHost();
+
+		if (!host)
+		{
+			throw std::runtime_error("Asio service needs a host, listen or connect first.");
+		}
+
+		// enet only supports IPv4
+		socket.assign(asio::ip::udp::v4(), host->socket);
+
+		// Sends made between ticks have to reach the socket. Any thread of the pool may run a tick, and later send from
+		// outside the strand, so sends only go straight to enet from inside a tick
+		endpoint.setOnSendQueued([this]() { wake(); });
+		endpoint.setTickThreadOwnsHost(false);
+
+		// A wake posted before a stop() may never have run
+		servicePending.store(false);
+		running.store(true);
+
+		asio::post(strand, [this]() { service(); waitReadable(); });
+	}
+
+	// Stop servicing and give the socket back to enet
+
+	template<typename Endpoint>
+	void AsioService<Endpoint>::stop()
+	{
+		if (!running.exchange(false))
+		{
+			return;
+		}
+
+		endpoint.setOnSendQueued(nullptr);
+		endpoint.setTickThreadOwnsHost(true);
+
+		servicePending.store(false);
+
+		timer.cancel();
+		socket.cancel();
+
+		// Don't let asio close it, enet owns it
+		socket.release();
+	}
+
+	// Service soon, any thread (cheap when a service is already on its way)
+
+	template<typename Endpoint>
+	void AsioService<Endpoint>::wake()
+	{
+		if (servicePending.exchange(true))
+		{
+			return;
+		}
+
+		asio::post(strand, [this]()
+			{
+				if (running.load())
+				{
+					service();
+				}
+			});
+	}
+
+	template<typename Endpoint>
+	AsioService<Endpoint>::~AsioService()
+	{
+		stop();
+	}
+
+	/// <summary>
+	/// Wait for the enet socket to have a datagram
+	/// </summary>
+
+	template<typename Endpoint>
+	void AsioService<Endpoint>::waitReadable()
+	{
+		socket.async_wait(asio::ip::udp::socket::wait_read, asio::bind_executor(strand,
+			[this](const asio::error_code& error)
+			{
+				if (error || !running.load())
+				{
+					return;
+				}
+
+				service();
+				waitReadable();
+			}));
+
+		// The wait only fires for datagrams arriving from now on, the ones that came in during the last tick
+		// would sit there until the next one or the timer
+		asio::error_code error;
+		if (socket.available(error) > 0 && !error)
+		{
+			wake();
+		}
+	}
+
+	/// <summary>
+	/// Wait until enet's next deadline (at most maxWait)
+	/// </summary>
+
+	template<typename Endpoint>
+	void AsioService<Endpoint>::armTimer()
+	{
+		// Replaces (cancels) the previous wait
+		timer.expires_after(std::chrono::milliseconds(timeUntilNextDeadline(host, maxWait)));
+
+		timer.async_wait(asio::bind_executor(strand,
+			[this](const asio::error_code& error)
+			{
+				if (error || !running.load())
+				{
+					return;
+				}
+
+				service();
+			}));
+	}
+
+	/// <summary>
+	/// Tick the endpoint, then wait for its next deadline
+	/// </summary>
+
+	template<typename Endpoint>
+	void AsioService<Endpoint>::service()
+	{
+		servicePending.store(false);
+
+		endpoint.tick();
+
+		armTimer();
+	}
+
+	/// <summary>
+	/// Milliseconds until enet has something to do without traffic: a resend, a ping, the bandwidth throttle
+	/// </summary>
+	/// <param name="host"></param>
+	/// <param name="maxWait"></param>
+	/// <returns></returns>
+
+	template<typename Endpoint>
+	LNet4Byte AsioService<Endpoint>::timeUntilNextDeadline(const ENetHost* host, const LNet4Byte& maxWait)
+	{
+		const enet_uint32 now = enet_time_get();
+		LNet4Byte wait = maxWait;
+
+		auto consider = [&](const enet_uint32 deadline)
+			{
+				wait = ENET_TIME_LESS_EQUAL(deadline, now) ? 0 : std::min<LNet4Byte>(wait, ENET_TIME_DIFFERENCE(deadline, now));
+			};
+
+		for (const ENetPeer* peer = host->peers; peer < &host->peers[host->peerCount]; ++peer)
+		{
+			if (peer->state == ENET_PEER_STATE_DISCONNECTED || peer->state == ENET_PEER_STATE_ZOMBIE)
+			{
+				continue;
+			}
+
+			// Oldest unacknowledged reliable command gets resent
+			if (!enet_list_empty(&peer->sentReliableCommands))
+			{
+				consider(peer->nextTimeout);
+			}
+
+			// Quiet peers get pinged
+			consider(peer->lastReceiveTime + peer->pingInterval);
+		}
+
+		if (host->incomingBandwidth != 0 || host->outgoingBandwidth != 0)
+		{
+			consider(host->bandwidthThrottleEpoch + ENET_HOST_BANDWIDTH_THROTTLE_INTERVAL);
+		}
+
+		return wait;
+	}
+}
+
+#endif
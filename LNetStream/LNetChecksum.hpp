@@ -0,0 +1,46 @@
+#ifndef LNET_CHECKSUM_HPP
+#define LNET_CHECKSUM_HPP
+
+#include <enet/enet.h>
+#include <cstddef>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// CRC32C (Castagnoli), computed with the SSE4.2 crc32 instruction when the cpu has it, with tables otherwise
+	class Checksum
+	{
+	public:
+		// ENetChecksumCallback, set as a host's checksum to have enet check every datagram (both ends must use it)
+		static enet_uint32 ENET_CALLBACK enetCallback(const ENetBuffer* buffers, size_t bufferCount);
+
+		// CRC32C of the data, continues from crc when given the result over the data before it
+		static LNet4Byte crc32c(const void* data, const size_t length, const LNet4Byte crc = 0);
+
+		// Whether the crc32 instruction is used
+		static bool isHardwareAccelerated();
+
+	private:
+
+		/// <summary>
+		/// Update a running (inverted) crc with the crc32 instruction
+		/// </summary>
+		static LNet4Byte updateHardware(LNet4Byte state, const LNetByte* data, size_t length);
+
+		/// <summary>
+		/// Update a running (inverted) crc with the tables, 8 bytes per step
+		/// </summary>
+		static LNet4Byte updateSoftware(LNet4Byte state, const LNetByte* data, size_t length);
+
+		/// <summary>
+		/// Ask the cpu for SSE4.2
+		/// </summary>
+		static bool detectHardware();
+
+	private:
+
+		static const bool hardwareAccelerated;
+	};
+}
+
+#endif
@@ -1,14 +1,15 @@
 #include "LNetClient.hpp"
+#include <algorithm>
 
 namespace lnet
 {
 
-	ClientSettings::ClientSettings(const LNetByte& channels) : channels(channels), address()
+	ClientSettings::ClientSettings(const LNetByte& channels) : channels(channels), physicalChannels(channels), address()
 	{
 		// only if channels has a correct value
 		assert(channels < 255);
 	}
-	ClientSettings::ClientSettings(const LNetByte& channels, const LNet2Byte& port, const std::string& ip) : channels(channels)
+	ClientSettings::ClientSettings(const LNetByte& channels, const LNet2Byte& port, const std::string& ip) : channels(channels), physicalChannels(channels)
 	{
 		setAddress(port, ip);
 	}
@@ -20,7 +21,8 @@ namespace lnet
 
 	Client::Client(const LNetByte& channels) :
 		settings(channels),
-		host(nullptr)
+		host(nullptr),
+		connection(nullptr)
 	{
 		if (enet_initialize() != 0)
 		{
@@ -28,20 +30,25 @@ namespace lnet
 			return;
 		}
 	}
-	void Client::connect(const LNet2Byte& port, const std::string& ip)
+	void Client::connect(const LNet2Byte& port, const std::string& ip, const LNet4Byte& token)
 	{
 		settings.setAddress(port, ip);
+		latestOnlyFilter.clear();
+		latestOnlySequencer.clear();
 
 		// create host
-		host = enet_host_create(nullptr, 1, settings.channels, 0, 0);
+		host = enet_host_create(nullptr, 1, settings.physicalChannels, 0, 0);
 
 		if (!host)
 		{
 			throw std::runtime_error("Couldn't create server.");
 		}
 
+		compression.install(host, settings.compression);
+		host->checksum = settings.checksum ? Checksum::enetCallback : nullptr;
+
 		// create a connection to the server
-		connection = enet_host_connect(host, &settings.address, settings.channels, 0);
+		connection = enet_host_connect(host, &settings.address, settings.physicalChannels, token);
 
 		if (!connection)
 		{
@@ -55,60 +62,212 @@ namespace lnet
 	}
 	void Client::tick()
 	{
+		tick(TickBudget());
+	}
+	void Client::tick(const TickBudget& budget)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		// Take what the network thread received
+		Message received;
+		while (receivedMessages.pop(received))
+		{
+			deferMessage(std::move(received));
+		}
+
+		// The network thread services the host
+		if (useNetworkThread)
+		{
+			dispatchDeferred(budget, start);
+
+			// No callback runs between ticks, free the callback pages replaced since the last one
+			messageCallbacks.reclaim();
+			return;
+		}
+
+		// This thread owns the host, send what other threads queued first
+		tickThread.store(std::this_thread::get_id());
+		executeQueuedSends();
+
+		// Always service the host fully, only the callbacks are budgeted
 		ENetEvent event;
 		while (enet_host_service(host, &event, 0) > 0)
 		{
-			switch (event.type)
-			{
-			case ENET_EVENT_TYPE_CONNECT:
-			{
-				// nothing for now
-				std::cout << "Client-connection\n";
-				break;
-			}
-			case ENET_EVENT_TYPE_DISCONNECT:
-			{
-				// nothing for now
-				std::cout << "Client-disconnection\n";
-				break;
-			}
-			case ENET_EVENT_TYPE_RECEIVE:
-			{
-				std::cout << "Client-receive\n";
-				handleReceive(event);
-				enet_packet_destroy(event.packet);
-				break;
-			}
-			default:
-			{
-				std::cout << "Unknown event in the server.\n" <<
-					"Peer DATA: " << event.peer->data <<
-					"Type: " << event.type <<
-					"Channel" << event.channelID <<
-					"packet" << event.packet;
-			}
-			}
+			handleEvent(event);
 		}
+
+		publishStats();
+
+		dispatchDeferred(budget, start);
+		messageCallbacks.reclaim();
+
+		// What the callbacks sent
+		aggregator.flush();
+
+		if (!tickThreadOwnsHost.load())
+		{
+			tickThread.store(std::thread::id());
+		}
+	}
+	void Client::setPriorityChannel(const LNetByte& channel, const bool isPriority)
+	{
+		priorityChannels[channel] = isPriority;
+	}
+	size_t Client::getDeferredMessageCount() const
+	{
+		return priorityMessages.size() + deferredMessages.size();
+	}
+	void Client::setMaxDeferredMessages(const size_t count)
+	{
+		maxDeferredMessages = count;
+	}
+	size_t Client::getDroppedMessageCount() const
+	{
+		return droppedMessages;
 	}
 	void Client::terminate()
 	{
+		stopNetworkThread();
+
+		if (host)
+		{
+			// Send what other threads queued since the last tick
+			executeQueuedSends();
+			enet_host_flush(host);
+		}
+
 		enet_host_destroy(host);
 
 		host = nullptr;
 
+		priorityMessages.clear();
+		deferredMessages.clear();
+
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			publishedStats = {};
+		}
+
 		enet_deinitialize();
 	}
-	void Client::send(const Message& message)
+	void Client::startNetworkThread(const LNet4Byte& serviceTimeout)
 	{
-		ENetPacket* packet = message.toNetworkPacket();
+		if (!host)
+		{
+			throw std::runtime_error("Client must connect before starting the network thread.");
+		}
 
-		enet_peer_send(connection,
-			message.getMsgChannel(),
-			packet);
+		useNetworkThread = true;
+
+		networkThread.start(host, serviceTimeout,
+			[this]() { beforeService(); },
+			[this](const ENetEvent& event) { handleEvent(event); });
+	}
+	void Client::stopNetworkThread()
+	{
+		networkThread.stop();
+
+		useNetworkThread = false;
+
+		// Whatever didn't fit the queue can be called by the next tick()
+		while (!receivedOverflow.empty() && receivedMessages.push(std::move(receivedOverflow.front())))
+		{
+			receivedOverflow.pop_front();
+		}
+	}
+
+	void Client::setCompression(const CompressionSettings& compression)
+	{
+		settings.compression = compression;
+
+		if (host && !useNetworkThread)
+		{
+			this->compression.install(host, settings.compression);
+		}
+	}
+
+	CompressionStats Client::getCompressionStats() const
+	{
+		return compression.getStats();
+	}
+
+	void Client::setPhysicalChannels(const LNetByte& count)
+	{
+		settings.physicalChannels = std::clamp<LNetByte>(count, 1, settings.channels);
+	}
+
+	MemoryFootprint Client::getMemoryFootprint() const
+	{
+		return MemoryFootprint::ofHost(host);
+	}
+
+	PeerStats Client::getStats() const
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+		return publishedStats;
+	}
+
+	ENetHost* Client::getHost() const
+	{
+		return host;
+	}
+
+	void Client::setOnSendQueued(const std::function<void()>& func)
+	{
+		onSendQueued = func;
+	}
+
+	void Client::setTickThreadOwnsHost(const bool owns)
+	{
+		tickThreadOwnsHost.store(owns);
+
+		if (!owns)
+		{
+			tickThread.store(std::thread::id());
+		}
+	}
+
+	void Client::setChecksum(const bool enabled)
+	{
+		settings.checksum = enabled;
+
+		if (host && !useNetworkThread)
+		{
+			host->checksum = settings.checksum ? Checksum::enetCallback : nullptr;
+		}
+	}
+
+	void Client::setAggregation(const size_t maxContainerSize)
+	{
+		aggregator.setMaxContainerSize(maxContainerSize);
+	}
+
+	// MESSAGE CALLBACKS
+
+	void Client::setMessageCallback(const MessageIdentifier& identifier, const LNetReadCallback& func)
+	{
+		messageCallbacks.set(identifier, func);
+	}
+	void Client::removeMessageCallback(const MessageIdentifier& identifier)
+	{
+		messageCallbacks.remove(identifier);
+	}
+
+	void Client::send(const Message& message)
+	{
+		queueSend({ SendTarget::Client, 0, {}, message.getMsgChannel(), message.toNetworkPacket() });
 	}
 
 	void Client::flush()
 	{
+		// The network thread flushes on its own
+		if (useNetworkThread)
+		{
+			networkThread.wake();
+			return;
+		}
+
+		executeQueuedSends();
 		enet_host_flush(host);
 	}
 
@@ -117,6 +276,45 @@ namespace lnet
 		return host;
 	}
 
+	/// <summary>
+	/// Handle any enet event (connect, disconnect, receive)
+	/// </summary>
+	/// <param name="event"></param>
+
+	void Client::handleEvent(const ENetEvent& event)
+	{
+		switch (event.type)
+		{
+		case ENET_EVENT_TYPE_CONNECT:
+		{
+			// nothing for now
+			std::cout << "Client-connection\n";
+			break;
+		}
+		case ENET_EVENT_TYPE_DISCONNECT:
+		{
+			// nothing for now
+			std::cout << "Client-disconnection\n";
+			break;
+		}
+		case ENET_EVENT_TYPE_RECEIVE:
+		{
+			std::cout << "Client-receive\n";
+			// the message takes the packet, it is destroyed with the last copy of the message
+			handleReceive(event);
+			break;
+		}
+		default:
+		{
+			std::cout << "Unknown event in the server.\n" <<
+				"Peer DATA: " << event.peer->data <<
+				"Type: " << event.type <<
+				"Channel" << event.channelID <<
+				"packet" << event.packet;
+		}
+		}
+	}
+
 	/// <summary>
 	/// Handle receiving message of a message
 	/// </summary>
@@ -124,14 +322,270 @@ namespace lnet
 
 	void Client::handleReceive(const ENetEvent& event)
 	{
-		Message message(event.packet->data, event.packet->dataLength, event.channelID);
+		// Too small to even hold a header, drop it
+		if (!Message::isNetworkMessage(event.packet->data, event.packet->dataLength))
+		{
+			enet_packet_destroy(event.packet);
+			return;
+		}
+
+		// Several messages sent together
+		if (Message::isNetworkContainer(event.packet->data, event.packet->dataLength))
+		{
+			for (Message& message : Message::fromContainerPacket(event.packet, event.channelID))
+			{
+				receiveMessage(message);
+			}
+			return;
+		}
+
+		Message message(event.packet, event.channelID);
+		receiveMessage(message);
+	}
+
+	/// <summary>
+	/// Drop a stale LatestOnly message, keep the others for the callbacks of tick()
+	/// </summary>
+	/// <param name="message"></param>
+
+	void Client::receiveMessage(Message& message)
+	{
+		// Older than a message of its kind that was already handled
+		if (message.getDeliveryMode() == DeliveryMode::LatestOnly && !latestOnlyFilter.accept(message))
+		{
+			return;
+		}
+
+		if (!useNetworkThread)
+		{
+			deferMessage(std::move(message));
+			return;
+		}
 
+		// Hand it to tick(), keep the order if earlier messages are still waiting for room
+		if (!receivedOverflow.empty() || !receivedMessages.push(std::move(message)))
+		{
+			receivedOverflow.push_back(std::move(message));
+		}
+	}
+
+	/// <summary>
+	/// Call the message's callback if it has one
+	/// </summary>
+	/// <param name="message"></param>
+
+	void Client::dispatchMessage(Message& message)
+	{
 		// Call message callback if exists
-		auto it = messageCallbacks.find(message.getMsgIdentifier());
-		if (it != messageCallbacks.end())
+		const LNetReadCallback* callback = messageCallbacks.find(message.getMsgIdentifier());
+		if (callback)
 		{
-			it->second(message);
+			(*callback)(message);
+		}
+	}
+
+	/// <summary>
+	/// Keep a received message for the callbacks of this tick or the next ones (thread calling tick())
+	/// </summary>
+	/// <param name="message"></param>
+
+	void Client::deferMessage(Message&& message)
+	{
+		// Callbacks fall behind for good, don't let what waits for them grow without limit
+		if (getDeferredMessageCount() >= maxDeferredMessages)
+		{
+			droppedMessages++;
+			return;
 		}
+
+		if (priorityChannels[message.getMsgChannel()])
+		{
+			priorityMessages.push_back(std::move(message));
+		}
+		else
+		{
+			deferredMessages.push_back(std::move(message));
+		}
+	}
+
+	/// <summary>
+	/// Call the callbacks of deferred messages until the budget runs out, priority channels first
+	/// </summary>
+	/// <param name="budget"></param>
+	/// <param name="start"></param>
+
+	void Client::dispatchDeferred(const TickBudget& budget, const std::chrono::steady_clock::time_point& start)
+	{
+		size_t handled = 0;
+
+		// The first one whatever the budget, servicing alone may have used it up
+		while (handled == 0 || !budget.isExhausted(handled, start))
+		{
+			std::deque<Message>& queue = priorityMessages.empty() ? deferredMessages : priorityMessages;
+
+			if (queue.empty())
+			{
+				return;
+			}
+
+			Message message = std::move(queue.front());
+			queue.pop_front();
+
+			dispatchMessage(message);
+			handled++;
+		}
+	}
+
+	/// <summary>
+	/// Send the packet now when called by the thread owning the host, otherwise queue it for that thread (any thread)
+	/// </summary>
+	/// <param name="command"></param>
+
+	void Client::queueSend(SendCommand&& command)
+	{
+		const bool threaded = useNetworkThread.load();
+
+		// The thread calling tick() owns the host when there is no network thread
+		if (!threaded && std::this_thread::get_id() == tickThread.load())
+		{
+			executeSend(command);
+
+			if (onSendQueued)
+			{
+				onSendQueued();
+			}
+			return;
+		}
+
+		// Once one send overflowed the later ones follow it, so a sender's sends keep their order
+		if (hasSendOverflow.load() || !sendCommands.push(std::move(command)))
+		{
+			std::lock_guard<std::mutex> lock(sendOverflowMutex);
+			sendOverflow.push_back(std::move(command));
+			hasSendOverflow.store(true);
+		}
+
+		if (threaded)
+		{
+			networkThread.wake();
+		}
+		else if (onSendQueued)
+		{
+			onSendQueued();
+		}
+	}
+
+	/// <summary>
+	/// Queue the command's packet on the connection, on the thread that owns the host
+	/// </summary>
+	/// <param name="command"></param>
+
+	void Client::executeSend(SendCommand& command)
+	{
+		// LatestOnly sequences count per channel and type on this connection
+		LNet2Byte latestOnlyType;
+		if (Message::latestOnlyTypeOf(command.packet, latestOnlyType))
+		{
+			MessageIdentifier identifier(command.channel, latestOnlyType);
+			LNet2Byte sequence = latestOnlySequencer.peek(identifier);
+
+			Message::setLatestOnlySequence(command.packet, sequence);
+			latestOnlySequencer.take(identifier, sequence);
+		}
+
+		// Channels enet didn't allocate ride on the ones it did, with the real channel in front of the message
+		if (connection && command.channel >= connection->channelCount)
+		{
+			command.packet = Message::toChannelEscapedPacket(command.packet, command.channel);
+			command.channel %= connection->channelCount;
+		}
+
+		if (connection && aggregator.accepts(command.packet))
+		{
+			aggregator.add(connection, command.channel, command.packet);
+			enet_packet_destroy(command.packet);
+			command.packet = nullptr;
+			return;
+		}
+
+		// Sent on its own, what was packed before it has to leave first to keep the order
+		aggregator.flush();
+
+		if (!connection || enet_peer_send(connection, command.channel, command.packet) < 0)
+		{
+			enet_packet_destroy(command.packet);
+		}
+
+		command.packet = nullptr;
+	}
+
+	/// <summary>
+	/// Network thread, runs before every enet_host_service (sends what was queued, retries received messages that didn't fit)
+	/// </summary>
+
+	void Client::beforeService()
+	{
+		while (!receivedOverflow.empty() && receivedMessages.push(std::move(receivedOverflow.front())))
+		{
+			receivedOverflow.pop_front();
+		}
+
+		executeQueuedSends();
+
+		if (std::chrono::steady_clock::now() - lastStatsPublish >= std::chrono::milliseconds(LNET_STATS_PUBLISH_INTERVAL))
+		{
+			publishStats();
+		}
+	}
+
+	/// <summary>
+	/// Copy the connection's stats for the other threads (thread owning the host)
+	/// </summary>
+
+	void Client::publishStats()
+	{
+		const PeerStats stats = PeerStats::ofPeer(connection);
+
+		std::lock_guard<std::mutex> lock(statsMutex);
+		publishedStats = stats;
+		lastStatsPublish = std::chrono::steady_clock::now();
+	}
+
+	/// <summary>
+	/// Send everything other threads queued, in one batch (thread owning the host only)
+	/// </summary>
+
+	void Client::executeQueuedSends()
+	{
+		SendCommand command;
+		while (sendCommands.pop(command))
+		{
+			executeSend(command);
+		}
+
+		if (hasSendOverflow.load())
+		{
+			std::deque<SendCommand> overflow;
+			{
+				std::lock_guard<std::mutex> lock(sendOverflowMutex);
+
+				// What made it into the queue before a send overflowed goes first
+				while (sendCommands.pop(command))
+				{
+					executeSend(command);
+				}
+
+				overflow.swap(sendOverflow);
+				hasSendOverflow.store(false);
+			}
+
+			for (SendCommand& overflowed : overflow)
+			{
+				executeSend(overflowed);
+			}
+		}
+
+		aggregator.flush();
 	}
 
 
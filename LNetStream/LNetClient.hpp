@@ -4,7 +4,20 @@
 #include <cassert>
 #include <enet/enet.h>
 #include <unordered_map>
+#include "LNetAggregator.hpp"
+#include "LNetChecksum.hpp"
+#include "LNetCompression.hpp"
+#include "LNetMemoryFootprint.hpp"
+#include "LNetPeerStats.hpp"
+#include "LNetTickBudget.hpp"
+#include "LNetDispatchTable.hpp"
+#include "LNetLatestOnlyFilter.hpp"
 #include "LNetMessage.hpp"
+#include "LNetNetworkThread.hpp"
+#include "LNetMpscQueue.hpp"
+#include "LNetSpscQueue.hpp"
+#include <deque>
+#include <mutex>
 
 namespace lnet
 {
@@ -12,10 +25,19 @@ namespace lnet
 	{
 		// should match the server
 		LNetByte channels;
+
+		// channels enet allocates (at most channels), the ones above are carried over them
+		LNetByte physicalChannels;
 		
 		// server address
 		ENetAddress address;
 
+		// none by default, should match the server
+		CompressionSettings compression;
+
+		// CRC32C of every datagram, checked by enet, off by default, should match the server
+		bool checksum = false;
+
 		ClientSettings(const LNetByte& channels);
 		ClientSettings(const LNetByte& channels, const LNet2Byte& port, const std::string& ip);
 		void setAddress(const LNet2Byte& port, const std::string& ip);
@@ -30,16 +52,80 @@ namespace lnet
 
 		Client(const LNetByte& channels = 16);
 
-		void connect(const LNet2Byte& port, const std::string& ip);
+		// The token (session, ticket...) reaches the server in enet's connect data, see Server::setConnectValidator
+		void connect(const LNet2Byte& port, const std::string& ip, const LNet4Byte& token = 0);
 
 		void tick();
 
+		// Services the host as tick() does (so enet's timing never suffers), handles connections and disconnections,
+		// then calls message callbacks until the budget runs out: priority channels first, the rest in order.
+		// Messages left over are called first by the next tick, at least one is called per tick whatever the budget
+		void tick(const TickBudget& budget);
+
+		// Messages on priority channels are called before the others (from the thread calling tick())
+		void setPriorityChannel(const LNetByte& channel, const bool isPriority = true);
+
+		// Received messages still waiting for their callback
+		size_t getDeferredMessageCount() const;
+
+		// Most received messages waiting for their callback, the ones arriving past it are dropped, reliable ones included.
+		// For budgeted ticks that would rather lose messages than fall behind for good (from the thread calling tick(), no limit by default)
+		void setMaxDeferredMessages(const size_t count);
+
+		// Received messages dropped because too many were waiting
+		size_t getDroppedMessageCount() const;
+
 		void terminate();
 
+		// Run the host on its own thread, blocking in enet_host_service up to serviceTimeout milliseconds.
+		// tick() then only calls the callbacks of what that thread received, and sends are handed to it.
+		// Start and stop it from the thread calling tick()
+		void startNetworkThread(const LNet4Byte& serviceTimeout = LNET_DEFAULT_SERVICE_TIMEOUT);
+		void stopNetworkThread();
+
+
+
+		// Pack the small messages sent to a peer on one channel during a tick into container packets of at most
+		// maxContainerSize bytes, 0 sends every message in its own packet (off by default, any thread)
+		void setAggregation(const size_t maxContainerSize = LNET_DEFAULT_CONTAINER_SIZE);
+
+		// Compress the host's datagrams, takes effect at the next connect() (or now when already connected, without a network thread)
+		void setCompression(const CompressionSettings& compression);
+		CompressionStats getCompressionStats() const;
+
+		// Have enet allocate only the first count channels (see Server::setPhysicalChannels), takes effect at the next connect()
+		void setPhysicalChannels(const LNetByte& count);
+
+		// What enet keeps for the host and the connection (thread owning the host)
+		MemoryFootprint getMemoryFootprint() const;
+
+		// What enet measured about the connection, empty before connect().
+		// Any thread, a copy the thread owning the host refreshes every tick or LNET_STATS_PUBLISH_INTERVAL
+		PeerStats getStats() const;
+
+		// The enet host, for loops that service it themselves (see AsioService)
+		ENetHost* getHost() const;
+
+		// Called after every send queued without a network thread, so an outside loop can service the host soon.
+		// Set it before sending from other threads
+		void setOnSendQueued(const std::function<void()>& func);
 
+		// Whether the thread that called tick() keeps owning the host between ticks and sends directly (the default).
+		// Off for loops that tick from a thread pool (see AsioService): that thread may send later from outside the loop,
+		// so only the sends made during tick() are direct and the others are queued for the next one
+		void setTickThreadOwnsHost(const bool owns);
+
+		// Have enet drop corrupted datagrams (CRC32C), takes effect at the next connect() (or now when already connected, without a network thread)
+		void setChecksum(const bool enabled);
+
+		void setMessageCallback(const MessageIdentifier& identifier, const LNetReadCallback& func);
+		void removeMessageCallback(const MessageIdentifier& identifier);
 
 		void send(const Message& message);
 
+		template<typename... Args>
+		void send(const DeliveryMode& mode, const MessageIdentifier& identifier, const Args&... args);
+
 		template<typename... Args>
 		void sendReliable(const MessageIdentifier& identifier, const Args&... args);
 
@@ -52,12 +138,70 @@ namespace lnet
 
 	private:
 
+		/// <summary>
+		/// Handle any enet event (connect, disconnect, receive)
+		/// </summary>
+		/// <param name="event"></param>
+		void handleEvent(const ENetEvent& event);
+
 		/// <summary>
 		/// Handle receiving message of a message
 		/// </summary>
 		/// <param name="event"></param>
 		void handleReceive(const ENetEvent& event);
 
+		/// <summary>
+		/// Drop a stale LatestOnly message, keep the others for the callbacks of tick()
+		/// </summary>
+		/// <param name="message"></param>
+		void receiveMessage(Message& message);
+
+		/// <summary>
+		/// Call the message's callback if it has one
+		/// </summary>
+		/// <param name="message"></param>
+		void dispatchMessage(Message& message);
+
+		/// <summary>
+		/// Keep a received message for the callbacks of this tick or the next ones (thread calling tick())
+		/// </summary>
+		/// <param name="message"></param>
+		void deferMessage(Message&& message);
+
+		/// <summary>
+		/// Call the callbacks of deferred messages until the budget runs out, priority channels first
+		/// </summary>
+		/// <param name="budget"></param>
+		/// <param name="start"></param>
+		void dispatchDeferred(const TickBudget& budget, const std::chrono::steady_clock::time_point& start);
+
+		/// <summary>
+		/// Send the packet now when called by the thread owning the host, otherwise queue it for that thread (any thread)
+		/// </summary>
+		/// <param name="command"></param>
+		void queueSend(SendCommand&& command);
+
+		/// <summary>
+		/// Queue the command's packet on the connection, on the thread that owns the host
+		/// </summary>
+		/// <param name="command"></param>
+		void executeSend(SendCommand& command);
+
+		/// <summary>
+		/// Send everything other threads queued, in one batch (thread owning the host only)
+		/// </summary>
+		void executeQueuedSends();
+
+		/// <summary>
+		/// Network thread, runs before every enet_host_service (sends what was queued, retries received messages that didn't fit)
+		/// </summary>
+		void beforeService();
+
+		/// <summary>
+		/// Copy the connection's stats for the other threads (thread owning the host)
+		/// </summary>
+		void publishStats();
+
 	private:
 		// Connection data
 		ClientSettings settings;
@@ -68,34 +212,76 @@ namespace lnet
 		ENetPeer* connection;
 
 		// Message callbacks
-		std::unordered_map<MessageIdentifier, LNetReadCallback, HashMessageIdentifier> messageCallbacks;
+		DispatchTable<LNetReadCallback> messageCallbacks;
+
+		// Newest LatestOnly sequences from the server
+		LatestOnlyFilter latestOnlyFilter;
+		// Next LatestOnly sequences to the server (thread owning the host)
+		LatestOnlySequencer latestOnlySequencer;
+
+		// Network thread mode
+		NetworkThread networkThread;
+		std::atomic<bool> useNetworkThread = false;
+
+		// Thread that last called tick(), without a network thread it owns the host and sends directly
+		std::atomic<std::thread::id> tickThread;
+		std::atomic<bool> tickThreadOwnsHost = true;
+
+		// network thread -> tick()
+		SpscQueue<Message> receivedMessages;
+		// Received messages that didn't fit in the queue (network thread only)
+		std::deque<Message> receivedOverflow;
+
+		// Received messages waiting for their callback (thread calling tick())
+		std::deque<Message> priorityMessages;
+		std::deque<Message> deferredMessages;
+		std::array<bool, 256> priorityChannels{};
+		size_t maxDeferredMessages = LNET_DEFAULT_MAX_DEFERRED_MESSAGES;
+		size_t droppedMessages = 0;
+
+		// send functions on any thread -> thread owning the host
+		MpscQueue<SendCommand> sendCommands{ LNET_SEND_QUEUE_CAPACITY };
+		// Sends that found the queue full, a sender never waits for room (nothing may be draining it)
+		std::mutex sendOverflowMutex;
+		std::deque<SendCommand> sendOverflow;
+		std::atomic<bool> hasSendOverflow = false;
+		std::function<void()> onSendQueued;
+
+		// Small messages waiting to be sent together (thread owning the host only)
+		Aggregator aggregator;
+
+		// thread owning the host -> getStats()
+		mutable std::mutex statsMutex;
+		PeerStats publishedStats;
+		std::chrono::steady_clock::time_point lastStatsPublish;
+
+		// The host's compressor
+		Compression compression;
 	};
 
 	// template sending functions
 
+	template<typename ...Args>
+	void Client::send(const DeliveryMode& mode, const MessageIdentifier& identifier, const Args & ...args)
+	{
+		Message message = Message::createByArgs(mode, identifier.channel, identifier.type, args...);
+
+		queueSend({ SendTarget::Client, 0, {}, identifier.channel, message.toNetworkPacket() });
+	}
+
 	template<typename ...Args>
 	void Client::sendReliable(const MessageIdentifier& identifier, const Args & ...args)
 	{
 		Message message = Message::createByArgs(true, identifier.channel, identifier.type, args...);
 
-		ENetPacket* packet = message.toNetworkPacket();
-
-		enet_peer_send(connection,
-			identifier.channel,
-			packet
-		);
+		queueSend({ SendTarget::Client, 0, {}, identifier.channel, message.toNetworkPacket() });
 	}
 	template<typename ...Args>
 	void Client::sendUnreliable(const MessageIdentifier& identifier, const Args & ...args)
 	{
 		Message message = Message::createByArgs(false, identifier.channel, identifier.type, args...);
 
-		ENetPacket* packet = message.toNetworkPacket();
-
-		enet_peer_send(connection,
-			identifier.channel,
-			packet
-		);
+		queueSend({ SendTarget::Client, 0, {}, identifier.channel, message.toNetworkPacket() });
 
 	}
 }
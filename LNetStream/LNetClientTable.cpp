@@ -0,0 +1,158 @@
+#include "LNetClientTable.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace lnet
+{
+	// Size the table for a host, forgets every client. Generations are kept, so IDs of an earlier host stay stale
+
+	void ClientTable::reset(const size_t peerCount)
+	{
+		if (peerCount > LNET_CLIENT_INDEX_MASK + 1)
+		{
+			throw std::runtime_error("Too many peers for the client table.");
+		}
+
+		clear();
+
+		peers.assign(peerCount, nullptr);
+		// Never shrinks, a slot dropped by a smaller host keeps its generation for a bigger one later
+		generations.resize(std::max(generations.size(), peerCount), 0);
+		connected.assign(peerCount, false);
+		latestOnlyFilters.assign(peerCount, LatestOnlyFilter());
+		latestOnlySequencers.assign(peerCount, LatestOnlySequencer());
+		tokens.assign(peerCount, 0);
+
+		connectedClients = 0;
+	}
+
+	// Forget every client, stale IDs stay stale. Never touches the peers (their host may be destroyed already)
+
+	void ClientTable::clear()
+	{
+		for (size_t slot = 0; slot < connected.size(); slot++)
+		{
+			removeAt(slot);
+		}
+	}
+
+	// A peer connected with the token from its connect data, returns its client ID
+
+	LNet4Byte ClientTable::add(ENetPeer* peer, const LNet4Byte& token)
+	{
+		size_t slot = peer->incomingPeerID;
+
+		if (!connected[slot])
+		{
+			connected[slot] = true;
+			connectedClients++;
+		}
+
+		peers[slot] = peer;
+		latestOnlyFilters[slot].clear();
+		latestOnlySequencers[slot].clear();
+		tokens[slot] = token;
+
+		return idAt(slot);
+	}
+
+	// A peer disconnected, returns the client ID it had
+
+	LNet4Byte ClientTable::remove(ENetPeer* peer)
+	{
+		return removeAt(peer->incomingPeerID);
+	}
+
+	/// <summary>
+	/// Free a slot, returns the client ID it had
+	/// </summary>
+	/// <param name="slot"></param>
+	/// <returns></returns>
+
+	LNet4Byte ClientTable::removeAt(const size_t slot)
+	{
+		LNet4Byte clientID = idAt(slot);
+
+		if (connected[slot])
+		{
+			connected[slot] = false;
+			connectedClients--;
+
+			// Every ID handed out for this slot so far is stale from now on
+			generations[slot] = (generations[slot] + 1) & LNET_CLIENT_GENERATION_MASK;
+		}
+
+		peers[slot] = nullptr;
+		latestOnlyFilters[slot].clear();
+		latestOnlySequencers[slot].clear();
+		tokens[slot] = 0;
+
+		return clientID;
+	}
+
+	// The client's peer, nullptr when the ID is unknown or stale
+
+	ENetPeer* ClientTable::find(const LNet4Byte& clientID) const
+	{
+		size_t slot = slotOf(clientID);
+
+		if (slot >= connected.size() || !connected[slot] || idAt(slot) != clientID)
+		{
+			return nullptr;
+		}
+
+		return peers[slot];
+	}
+
+	// Client ID of a connected peer
+
+	LNet4Byte ClientTable::idOf(const ENetPeer* peer) const
+	{
+		return idAt(peer->incomingPeerID);
+	}
+
+	size_t ClientTable::slotCount() const
+	{
+		return connected.size();
+	}
+
+	bool ClientTable::isConnected(const size_t slot) const
+	{
+		return connected[slot];
+	}
+
+	ENetPeer* ClientTable::peerAt(const size_t slot) const
+	{
+		return peers[slot];
+	}
+
+	LNet4Byte ClientTable::idAt(const size_t slot) const
+	{
+		return (static_cast<LNet4Byte>(generations[slot]) << LNET_CLIENT_INDEX_BITS) | static_cast<LNet4Byte>(slot);
+	}
+
+	size_t ClientTable::connectedCount() const
+	{
+		return connectedClients;
+	}
+
+	LatestOnlyFilter& ClientTable::latestOnlyFilterAt(const size_t slot)
+	{
+		return latestOnlyFilters[slot];
+	}
+
+	LatestOnlySequencer& ClientTable::latestOnlySequencerAt(const size_t slot)
+	{
+		return latestOnlySequencers[slot];
+	}
+
+	LNet4Byte ClientTable::tokenAt(const size_t slot) const
+	{
+		return tokens[slot];
+	}
+
+	size_t ClientTable::slotOf(const LNet4Byte& clientID)
+	{
+		return clientID & LNET_CLIENT_INDEX_MASK;
+	}
+}
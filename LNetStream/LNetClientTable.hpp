@@ -0,0 +1,79 @@
+#ifndef LNET_CLIENT_TABLE_HPP
+#define LNET_CLIENT_TABLE_HPP
+
+#include <enet/enet.h>
+#include <vector>
+#include "LNetLatestOnlyFilter.hpp"
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// A client ID is the peer's slot in the host (enet's incomingPeerID, below 4096) and the slot's generation above it.
+	// The generation changes every time the slot is freed, so an ID kept after its client left never finds the next one.
+	// The top 8 bits stay free (see ShardedServer)
+	constexpr int LNET_CLIENT_INDEX_BITS = 12;
+	constexpr int LNET_CLIENT_GENERATION_BITS = 12;
+	constexpr LNet4Byte LNET_CLIENT_INDEX_MASK = (1u << LNET_CLIENT_INDEX_BITS) - 1;
+	constexpr LNet4Byte LNET_CLIENT_GENERATION_MASK = (1u << LNET_CLIENT_GENERATION_BITS) - 1;
+
+	// Per client state of a server, one entry per peer slot of the host, stored as a struct of arrays
+	// so loops over every client scan small dense arrays
+	class ClientTable
+	{
+	public:
+		// Size the table for a host, forgets every client. Generations are kept, so IDs of an earlier host stay stale
+		void reset(const size_t peerCount);
+
+		// Forget every client, stale IDs stay stale. Never touches the peers (their host may be destroyed already)
+		void clear();
+
+		// A peer connected with the token from its connect data, returns its client ID
+		LNet4Byte add(ENetPeer* peer, const LNet4Byte& token = 0);
+
+		// A peer disconnected, returns the client ID it had
+		LNet4Byte remove(ENetPeer* peer);
+
+		// The client's peer, nullptr when the ID is unknown or stale
+		ENetPeer* find(const LNet4Byte& clientID) const;
+
+		// Client ID of a connected peer
+		LNet4Byte idOf(const ENetPeer* peer) const;
+
+		// Slots, for loops over every client
+		size_t slotCount() const;
+		bool isConnected(const size_t slot) const;
+		ENetPeer* peerAt(const size_t slot) const;
+		LNet4Byte idAt(const size_t slot) const;
+
+		size_t connectedCount() const;
+
+		// Per client state
+		LatestOnlyFilter& latestOnlyFilterAt(const size_t slot);
+		LatestOnlySequencer& latestOnlySequencerAt(const size_t slot);
+		LNet4Byte tokenAt(const size_t slot) const;
+
+		static size_t slotOf(const LNet4Byte& clientID);
+
+	private:
+
+		/// <summary>
+		/// Free a slot, returns the client ID it had
+		/// </summary>
+		/// <param name="slot"></param>
+		/// <returns></returns>
+		LNet4Byte removeAt(const size_t slot);
+
+	private:
+
+		std::vector<ENetPeer*> peers;
+		std::vector<LNet2Byte> generations;
+		std::vector<LNetByte> connected;
+		std::vector<LatestOnlyFilter> latestOnlyFilters;
+		std::vector<LatestOnlySequencer> latestOnlySequencers;
+		std::vector<LNet4Byte> tokens;
+
+		size_t connectedClients = 0;
+	};
+}
+
+#endif
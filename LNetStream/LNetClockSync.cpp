@@ -0,0 +1,171 @@
+#include "LNetClockSync.hpp"
+#include <chrono>
+
+namespace lnet
+{
+	// Microseconds of the steady clock, the time base of both sides
+
+	int64_t clockNow()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	// SERVER
+
+	ClockSyncServer::ClockSyncServer(Server& server, const LNetByte& channel) :
+		server(server),
+		channel(channel)
+	{
+		server.setMessageCallback({ channel, LNET_TYPE_CLOCK_PING },
+			[this](const LNet4Byte& clientID, Message& message) { handlePing(clientID, message); });
+	}
+
+	ClockSyncServer::~ClockSyncServer()
+	{
+		server.removeMessageCallback({ channel, LNET_TYPE_CLOCK_PING });
+	}
+
+	/// <summary>
+	/// Send the ping's time back with the server's
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <param name="message"></param>
+
+	void ClockSyncServer::handlePing(const LNet4Byte& clientID, Message& message)
+	{
+		// Remote input, a short ping is dropped rather than thrown out of tick()
+		if (message.getReadRemaining() < sizeof(int64_t))
+		{
+			return;
+		}
+
+		int64_t clientTime;
+		message >> clientTime;
+
+		// Unsequenced so it never waits behind reliable packets, that delay would count as round trip
+		server.sendClient(clientID, DeliveryMode::Unsequenced, channel, LNET_TYPE_CLOCK_PONG, clientTime, clockNow());
+	}
+
+	// CLIENT
+
+	ClockSyncClient::ClockSyncClient(Client& client, const LNetByte& channel, const LNet4Byte& interval) :
+		client(client),
+		channel(channel),
+		interval(static_cast<int64_t>(interval) * 1000),
+		lastPing(0),
+		sampleCount(0),
+		nextSample(0),
+		offset(0),
+		roundTripTime(0),
+		isSynced(false)
+	{
+		client.setMessageCallback({ channel, LNET_TYPE_CLOCK_PONG },
+			[this](Message& message) { handlePong(message); });
+	}
+
+	// Ping when it's time to, call it every frame while connected
+
+	void ClockSyncClient::update()
+	{
+		int64_t now = clockNow();
+
+		// The first pings go out quickly to get an estimate soon
+		int64_t wait = sampleCount < LNET_CLOCK_SYNC_BURST ? interval / 10 : interval;
+
+		if (lastPing && now - lastPing < wait)
+		{
+			return;
+		}
+
+		lastPing = now;
+
+		client.send(DeliveryMode::Unsequenced, { channel, LNET_TYPE_CLOCK_PING }, now);
+	}
+
+	// Forget the estimate (after a reconnect)
+
+	void ClockSyncClient::reset()
+	{
+		lastPing = 0;
+		sampleCount = 0;
+		nextSample = 0;
+
+		isSynced = false;
+	}
+
+	// Microseconds, the server's clockNow() as it is now
+
+	int64_t ClockSyncClient::serverTimeNow() const
+	{
+		return clockNow() + offset.load(std::memory_order_relaxed);
+	}
+
+	// Server time - local time, and the round trip time of the pong it came from, microseconds
+
+	int64_t ClockSyncClient::getOffset() const
+	{
+		return offset.load(std::memory_order_relaxed);
+	}
+
+	int64_t ClockSyncClient::getRoundTripTime() const
+	{
+		return roundTripTime.load(std::memory_order_relaxed);
+	}
+
+	bool ClockSyncClient::isSynchronized() const
+	{
+		return isSynced.load(std::memory_order_relaxed);
+	}
+
+	ClockSyncClient::~ClockSyncClient()
+	{
+		client.removeMessageCallback({ channel, LNET_TYPE_CLOCK_PONG });
+	}
+
+	/// <summary>
+	/// Add the pong's sample and estimate the offset again
+	/// </summary>
+	/// <param name="message"></param>
+
+	void ClockSyncClient::handlePong(Message& message)
+	{
+		// Malformed, drop it
+		if (message.getReadRemaining() < 2 * sizeof(int64_t))
+		{
+			return;
+		}
+
+		int64_t clientTime;
+		int64_t serverTime;
+		message >> clientTime >> serverTime;
+
+		int64_t now = clockNow();
+
+		// A pong from before a reset() or from the future is of no use
+		if (clientTime > now || clientTime < now - interval * static_cast<int64_t>(LNET_CLOCK_SYNC_SAMPLES))
+		{
+			return;
+		}
+
+		// The server read its clock about half way through the round trip
+		Sample& sample = samples[nextSample];
+		sample.roundTripTime = now - clientTime;
+		sample.offset = serverTime - (clientTime + sample.roundTripTime / 2);
+
+		nextSample = (nextSample + 1) % LNET_CLOCK_SYNC_SAMPLES;
+		sampleCount = std::min(sampleCount + 1, LNET_CLOCK_SYNC_SAMPLES);
+
+		const Sample* best = &samples[0];
+		for (size_t index = 1; index < sampleCount; index++)
+		{
+			if (samples[index].roundTripTime < best->roundTripTime)
+			{
+				best = &samples[index];
+			}
+		}
+
+		offset.store(best->offset, std::memory_order_relaxed);
+		roundTripTime.store(best->roundTripTime, std::memory_order_relaxed);
+		isSynced.store(true, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,116 @@
+#ifndef LNET_CLOCK_SYNC_HPP
+#define LNET_CLOCK_SYNC_HPP
+
+#include <array>
+#include <atomic>
+#include "LNetClient.hpp"
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	// [client send time], the server answers with a pong
+	constexpr LNet2Byte LNET_TYPE_CLOCK_PING = 0xFFF9;
+	// [client send time][server time]
+	constexpr LNet2Byte LNET_TYPE_CLOCK_PONG = 0xFFF8;
+
+	// Milliseconds between two pings once synchronized
+	constexpr LNet4Byte LNET_DEFAULT_CLOCK_SYNC_INTERVAL = 1000;
+
+	// Pongs the estimate is taken from, and how many are gathered quickly after connecting
+	constexpr size_t LNET_CLOCK_SYNC_SAMPLES = 16;
+	constexpr size_t LNET_CLOCK_SYNC_BURST = 4;
+
+	// Microseconds of the steady clock, the time base of both sides
+	int64_t clockNow();
+
+	// Answers ClockSyncClient's pings with the server's clock. Pings are answered by the server's tick(), so the clock is
+	// read when the ping is dispatched rather than when it arrived: the wait for the tick (and for the budget, see
+	// setPriorityChannel) counts as round trip. It grows the round trip time but the lowest one is kept, so a channel
+	// used only for this and set as priority keeps the error to a fraction of the tick interval
+	class ClockSyncServer
+	{
+	public:
+		ClockSyncServer(Server& server, const LNetByte& channel = 0);
+
+		ClockSyncServer(const ClockSyncServer&) = delete;
+		ClockSyncServer& operator=(const ClockSyncServer&) = delete;
+
+		~ClockSyncServer();
+
+	private:
+
+		/// <summary>
+		/// Send the ping's time back with the server's
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <param name="message"></param>
+		void handlePing(const LNet4Byte& clientID, Message& message);
+
+	private:
+
+		Server& server;
+		LNetByte channel;
+	};
+
+	// Estimates the offset between the server's clock and this one from timestamped pings. Of the last pongs,
+	// the one with the lowest round trip time was delayed the least, so its offset is taken (slower ones are outliers).
+	// Both sides read the clock when the message is dispatched by tick(), not when it arrived (see ClockSyncServer).
+	// update() and the pongs run on the thread calling the client's tick(), the getters on any thread
+	class ClockSyncClient
+	{
+	public:
+		ClockSyncClient(Client& client, const LNetByte& channel = 0, const LNet4Byte& interval = LNET_DEFAULT_CLOCK_SYNC_INTERVAL);
+
+		ClockSyncClient(const ClockSyncClient&) = delete;
+		ClockSyncClient& operator=(const ClockSyncClient&) = delete;
+
+		// Ping when it's time to, call it every frame while connected
+		void update();
+
+		// Forget the estimate (after a reconnect)
+		void reset();
+
+		// Microseconds, the server's clockNow() as it is now
+		int64_t serverTimeNow() const;
+
+		// Server time - local time, and the round trip time of the pong it came from, microseconds
+		int64_t getOffset() const;
+		int64_t getRoundTripTime() const;
+
+		bool isSynchronized() const;
+
+		~ClockSyncClient();
+
+	private:
+
+		struct Sample
+		{
+			int64_t offset = 0;
+			int64_t roundTripTime = 0;
+		};
+
+		/// <summary>
+		/// Add the pong's sample and estimate the offset again
+		/// </summary>
+		/// <param name="message"></param>
+		void handlePong(Message& message);
+
+	private:
+
+		Client& client;
+		LNetByte channel;
+
+		int64_t interval;
+		int64_t lastPing;
+
+		std::array<Sample, LNET_CLOCK_SYNC_SAMPLES> samples;
+		size_t sampleCount;
+		size_t nextSample;
+
+		std::atomic<int64_t> offset;
+		std::atomic<int64_t> roundTripTime;
+		std::atomic<bool> isSynced;
+	};
+}
+
+#endif
@@ -0,0 +1,163 @@
+#include "LNetCompression.hpp"
+#include <stdexcept>
+
+namespace lnet
+{
+	// Sent size / original size of the considered datagrams, 1 when nothing was considered
+
+	double CompressionStats::ratio() const
+	{
+		return bytesIn == 0 ? 1.0 : static_cast<double>(bytesOut) / static_cast<double>(bytesIn);
+	}
+
+	Compression::Compression() :
+		inner{},
+		threshold(LNET_DEFAULT_COMPRESSION_THRESHOLD),
+		datagramsConsidered(0),
+		datagramsCompressed(0),
+		bytesIn(0),
+		bytesOut(0),
+		datagramsDecompressed(0),
+		bytesReceived(0),
+		bytesDecompressed(0)
+	{ }
+
+	// Replace the host's compressor and reset the stats, CompressionMethod::None removes it
+
+	void Compression::install(ENetHost* host, const CompressionSettings& settings)
+	{
+		// enet destroys the compressor it had (ours included) first
+		enet_host_compress(host, nullptr);
+
+		datagramsConsidered.store(0, std::memory_order_relaxed);
+		datagramsCompressed.store(0, std::memory_order_relaxed);
+		bytesIn.store(0, std::memory_order_relaxed);
+		bytesOut.store(0, std::memory_order_relaxed);
+		datagramsDecompressed.store(0, std::memory_order_relaxed);
+		bytesReceived.store(0, std::memory_order_relaxed);
+		bytesDecompressed.store(0, std::memory_order_relaxed);
+
+		switch (settings.method)
+		{
+			case CompressionMethod::None:
+			{
+				return;
+			}
+			case CompressionMethod::RangeCoder:
+			{
+				inner.context = enet_range_coder_create();
+				inner.compress = enet_range_coder_compress;
+				inner.decompress = enet_range_coder_decompress;
+				inner.destroy = enet_range_coder_destroy;
+				break;
+			}
+			case CompressionMethod::Custom:
+			{
+				if (settings.createCustom)
+				{
+					inner = settings.createCustom();
+				}
+				break;
+			}
+		}
+
+		if (!inner.context || !inner.compress || !inner.decompress)
+		{
+			// Not given to enet, so nothing else would free it
+			if (inner.context && inner.destroy)
+			{
+				inner.destroy(inner.context);
+			}
+			inner = ENetCompressor{};
+
+			throw std::runtime_error("Couldn't create the compressor.");
+		}
+
+		threshold = settings.threshold;
+
+		ENetCompressor wrapper{ this, Compression::compress, Compression::decompress, Compression::destroy };
+		enet_host_compress(host, &wrapper);
+	}
+
+	CompressionStats Compression::getStats() const
+	{
+		CompressionStats stats;
+
+		stats.datagramsConsidered = datagramsConsidered.load(std::memory_order_relaxed);
+		stats.datagramsCompressed = datagramsCompressed.load(std::memory_order_relaxed);
+		stats.bytesIn = bytesIn.load(std::memory_order_relaxed);
+		stats.bytesOut = bytesOut.load(std::memory_order_relaxed);
+		stats.datagramsDecompressed = datagramsDecompressed.load(std::memory_order_relaxed);
+		stats.bytesReceived = bytesReceived.load(std::memory_order_relaxed);
+		stats.bytesDecompressed = bytesDecompressed.load(std::memory_order_relaxed);
+
+		return stats;
+	}
+
+	/// <summary>
+	/// enet's compress callback, compresses datagrams at least as big as the threshold with the inner compressor
+	/// </summary>
+
+	size_t ENET_CALLBACK Compression::compress(void* context, const ENetBuffer* inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8* outData, size_t outLimit)
+	{
+		Compression* compression = static_cast<Compression*>(context);
+
+		// 0 = send it uncompressed
+		if (inLimit < compression->threshold)
+		{
+			return 0;
+		}
+
+		size_t outSize = compression->inner.compress(compression->inner.context, inBuffers, inBufferCount, inLimit, outData, outLimit);
+
+		// enet only uses the result when it is smaller
+		const bool compressed = outSize > 0 && outSize < inLimit;
+
+		compression->datagramsConsidered.fetch_add(1, std::memory_order_relaxed);
+		compression->bytesIn.fetch_add(inLimit, std::memory_order_relaxed);
+		compression->bytesOut.fetch_add(compressed ? outSize : inLimit, std::memory_order_relaxed);
+
+		if (compressed)
+		{
+			compression->datagramsCompressed.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return outSize;
+	}
+
+	/// <summary>
+	/// enet's decompress callback
+	/// </summary>
+
+	size_t ENET_CALLBACK Compression::decompress(void* context, const enet_uint8* inData, size_t inLimit, enet_uint8* outData, size_t outLimit)
+	{
+		Compression* compression = static_cast<Compression*>(context);
+
+		size_t outSize = compression->inner.decompress(compression->inner.context, inData, inLimit, outData, outLimit);
+
+		if (outSize > 0)
+		{
+			compression->datagramsDecompressed.fetch_add(1, std::memory_order_relaxed);
+			compression->bytesReceived.fetch_add(inLimit, std::memory_order_relaxed);
+			compression->bytesDecompressed.fetch_add(outSize, std::memory_order_relaxed);
+		}
+
+		return outSize;
+	}
+
+	/// <summary>
+	/// enet's destroy callback, destroys the inner compressor's context
+	/// </summary>
+
+	void ENET_CALLBACK Compression::destroy(void* context)
+	{
+		Compression* compression = static_cast<Compression*>(context);
+
+		if (compression->inner.destroy)
+		{
+			compression->inner.destroy(compression->inner.context);
+		}
+
+		compression->inner = ENetCompressor{};
+	}
+}
@@ -0,0 +1,104 @@
+#ifndef LNET_COMPRESSION_HPP
+#define LNET_COMPRESSION_HPP
+
+#include <enet/enet.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// Datagrams smaller than this are sent as they are, compressing them rarely pays for itself
+	constexpr size_t LNET_DEFAULT_COMPRESSION_THRESHOLD = 128;
+
+	enum class CompressionMethod
+	{
+		None,
+		RangeCoder, // enet's built in adaptive range coder
+		Custom,     // The application's own compressor (LZ4, zstd with a trained dictionary...)
+	};
+
+	struct CompressionSettings
+	{
+		CompressionMethod method = CompressionMethod::None;
+
+		// Smallest datagram (in bytes) that is compressed
+		size_t threshold = LNET_DEFAULT_COMPRESSION_THRESHOLD;
+
+		// Used by CompressionMethod::Custom, called at every install for a compressor with its own context.
+		// enet calls that compressor's destroy when the host drops it (next install or host destroyed), so a context the
+		// application wants to keep must come with a null destroy and stays the application's to free.
+		// Both ends of a connection must use the same compressor
+		std::function<ENetCompressor()> createCustom;
+	};
+
+	// Totals since the compressor was installed
+	struct CompressionStats
+	{
+		// Outgoing datagrams big enough to be compressed, and how many of them got smaller
+		uint64_t datagramsConsidered = 0;
+		uint64_t datagramsCompressed = 0;
+
+		// Bytes of the considered datagrams before and after (a datagram that didn't shrink counts as sent)
+		uint64_t bytesIn = 0;
+		uint64_t bytesOut = 0;
+
+		// Incoming datagrams that were decompressed, compressed and decompressed bytes
+		uint64_t datagramsDecompressed = 0;
+		uint64_t bytesReceived = 0;
+		uint64_t bytesDecompressed = 0;
+
+		// Sent size / original size of the considered datagrams, 1 when nothing was considered
+		double ratio() const;
+	};
+
+	// Installs a compressor on a host, wrapped to skip small datagrams and count what it does.
+	// enet calls it on the thread servicing the host, the stats can be read from any thread
+	class Compression
+	{
+	public:
+		Compression();
+
+		Compression(const Compression&) = delete;
+		Compression& operator=(const Compression&) = delete;
+
+		// Replace the host's compressor and reset the stats, CompressionMethod::None removes it
+		void install(ENetHost* host, const CompressionSettings& settings);
+
+		CompressionStats getStats() const;
+
+	private:
+
+		/// <summary>
+		/// enet's compress callback, compresses datagrams at least as big as the threshold with the inner compressor
+		/// </summary>
+		static size_t ENET_CALLBACK compress(void* context, const ENetBuffer* inBuffers, size_t inBufferCount, size_t inLimit, enet_uint8* outData, size_t outLimit);
+
+		/// <summary>
+		/// enet's decompress callback
+		/// </summary>
+		static size_t ENET_CALLBACK decompress(void* context, const enet_uint8* inData, size_t inLimit, enet_uint8* outData, size_t outLimit);
+
+		/// <summary>
+		/// enet's destroy callback, destroys the inner compressor's context
+		/// </summary>
+		static void ENET_CALLBACK destroy(void* context);
+
+	private:
+
+		// What actually compresses
+		ENetCompressor inner;
+		size_t threshold;
+
+		std::atomic<uint64_t> datagramsConsidered;
+		std::atomic<uint64_t> datagramsCompressed;
+		std::atomic<uint64_t> bytesIn;
+		std::atomic<uint64_t> bytesOut;
+		std::atomic<uint64_t> datagramsDecompressed;
+		std::atomic<uint64_t> bytesReceived;
+		std::atomic<uint64_t> bytesDecompressed;
+	};
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef LNET_DISPATCH_TABLE_HPP
+#define LNET_DISPATCH_TABLE_HPP
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "LNetMessage.hpp"
+
+namespace lnet
+{
+	// Callbacks indexed straight by (channel, type): channel -> page directory -> page of 256 types.
+	// A lookup is three array loads with no hashing, and never takes a lock.
+	// Registering copies only the one page it changes and publishes the copy atomically, the old page is retired
+	// until reclaim(), so a callback found by a lookup stays valid while registrations go on
+	template<typename Callback>
+	class DispatchTable
+	{
+	public:
+		DispatchTable() = default;
+
+		DispatchTable(const DispatchTable&) = delete;
+		DispatchTable& operator=(const DispatchTable&) = delete;
+
+		~DispatchTable();
+
+		// Any thread, registrations are serialized between themselves only
+		void set(const MessageIdentifier& identifier, const Callback& callback);
+		void remove(const MessageIdentifier& identifier);
+
+		// Any thread, lock free, nullptr when there is no callback.
+		// The callback stays valid until the next reclaim()
+		const Callback* find(const MessageIdentifier& identifier) const;
+
+		// Free the pages replaced so far, only while no lookup is running or holding a callback
+		// (the thread dispatching calls it between dispatches)
+		void reclaim();
+
+	private:
+		static constexpr size_t pageBits = 8;
+		static constexpr size_t pageSize = 1 << pageBits;
+		static constexpr size_t pageCount = (std::numeric_limits<LNet2Byte>::max() + 1) >> pageBits;
+		static constexpr size_t channelCount = std::numeric_limits<LNetByte>::max() + 1;
+
+		struct Page
+		{
+			std::array<Callback, pageSize> callbacks;
+		};
+
+		struct Directory
+		{
+			std::array<std::atomic<const Page*>, pageCount> pages{};
+		};
+
+		/// <summary>
+		/// Publish a copy of the identifier's page with its callback replaced (an empty callback removes it)
+		/// </summary>
+		/// <param name="identifier"></param>
+		/// <param name="callback"></param>
+		void replace(const MessageIdentifier& identifier, const Callback& callback);
+
+	private:
+
+		std::array<std::atomic<Directory*>, channelCount> channels{};
+
+		std::mutex writeMutex;
+		std::vector<std::unique_ptr<Directory>> directories;
+
+		// Replaced pages lookups may still be reading, freed by reclaim() (the pages in use are owned by their directory slot)
+		std::vector<std::unique_ptr<const Page>> retiredPages;
+	};
+
+
+	template<typename Callback>
+	DispatchTable<Callback>::~DispatchTable()
+	{
+		for (const auto& directory : directories)
+		{
+			for (const std::atomic<const Page*>& page : directory->pages)
+			{
+				delete page.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	template<typename Callback>
+	void DispatchTable<Callback>::set(const MessageIdentifier& identifier, const Callback& callback)
+	{
+		replace(identifier, callback);
+	}
+
+	template<typename Callback>
+	void DispatchTable<Callback>::remove(const MessageIdentifier& identifier)
+	{
+		replace(identifier, Callback());
+	}
+
+	template<typename Callback>
+	const Callback* DispatchTable<Callback>::find(const MessageIdentifier& identifier) const
+	{
+		const Directory* directory = channels[identifier.channel].load(std::memory_order_acquire);
+		if (!directory)
+		{
+			return nullptr;
+		}
+
+		const Page* page = directory->pages[identifier.type >> pageBits].load(std::memory_order_acquire);
+		if (!page)
+		{
+			return nullptr;
+		}
+
+		const Callback& callback = page->callbacks[identifier.type & (pageSize - 1)];
+
+		return callback ? &callback : nullptr;
+	}
+
+	// Free the pages replaced so far, only while no lookup is running or holding a callback
+	// (the thread dispatching calls it between dispatches)
+
+	template<typename Callback>
+	void DispatchTable<Callback>::reclaim()
+	{
+		std::vector<std::unique_ptr<const Page>> pages;
+		{
+			std::lock_guard<std::mutex> lock(writeMutex);
+			pages.swap(retiredPages);
+		}
+	}
+
+	/// <summary>
+	/// Publish a copy of the identifier's page with its callback replaced (an empty callback removes it)
+	/// </summary>
+	/// <param name="identifier"></param>
+	/// <param name="callback"></param>
+
+	template<typename Callback>
+	void DispatchTable<Callback>::replace(const MessageIdentifier& identifier, const Callback& callback)
+	{
+		std::lock_guard<std::mutex> lock(writeMutex);
+
+		Directory* directory = channels[identifier.channel].load(std::memory_order_relaxed);
+		if (!directory)
+		{
+			directories.push_back(std::make_unique<Directory>());
+			directory = directories.back().get();
+
+			channels[identifier.channel].store(directory, std::memory_order_release);
+		}
+
+		std::atomic<const Page*>& slot = directory->pages[identifier.type >> pageBits];
+		const Page* oldPage = slot.load(std::memory_order_relaxed);
+
+		auto newPage = oldPage ? std::make_unique<Page>(*oldPage) : std::make_unique<Page>();
+		newPage->callbacks[identifier.type & (pageSize - 1)] = callback;
+
+		slot.store(newPage.release(), std::memory_order_release);
+
+		if (oldPage)
+		{
+			retiredPages.emplace_back(oldPage);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,225 @@
+#include "LNetEncodeJobs.hpp"
+
+namespace lnet
+{
+	// ARENA
+
+	EncodeArena::EncodeArena(const size_t blockSize) :
+		blockSize(blockSize),
+		block(0),
+		offset(0)
+	{
+	}
+
+	// Valid until the job ends
+
+	void* EncodeArena::allocate(const size_t size, const size_t alignment)
+	{
+		while (true)
+		{
+			if (block < blocks.size())
+			{
+				size_t aligned = (offset + alignment - 1) & ~(alignment - 1);
+
+				if (aligned + size <= blockSize)
+				{
+					offset = aligned + size;
+					return blocks[block].get() + aligned;
+				}
+
+				block++;
+				offset = 0;
+				continue;
+			}
+
+			if (size + alignment > blockSize)
+			{
+				throw std::runtime_error("Arena allocation is bigger than a block.");
+			}
+
+			blocks.push_back(std::make_unique<LNetByte[]>(blockSize));
+		}
+	}
+
+	// The worker's message, its payload keeps its capacity from job to job
+
+	Message& EncodeArena::message(const DeliveryMode mode, const LNetByte channel, const LNet2Byte type)
+	{
+		scratch.reset(channel, type);
+		scratch.setDeliveryMode(mode);
+
+		return scratch;
+	}
+
+	void EncodeArena::reset()
+	{
+		block = 0;
+		offset = 0;
+	}
+
+	// JOB SYSTEM
+
+	EncodeJobSystem::EncodeJobSystem(Server& server, const size_t workerCount) :
+		server(server),
+		jobClientIDs(nullptr),
+		jobFunction(nullptr),
+		nextJob(0),
+		generation(0),
+		activeWorkers(0),
+		isStopping(false)
+	{
+		for (size_t worker = 0; worker <= workerCount; worker++)
+		{
+			arenas.push_back(std::make_unique<EncodeArena>());
+		}
+
+		workers.reserve(workerCount);
+		for (size_t worker = 0; worker < workerCount; worker++)
+		{
+			workers.emplace_back(&EncodeJobSystem::workerLoop, this, worker);
+		}
+	}
+
+	// One job per client, sends the packets from the calling thread, then rethrows the first exception a job threw
+
+	void EncodeJobSystem::encode(const std::vector<LNet4Byte>& clientIDs, const LNetEncodeFunction& func)
+	{
+		if (clientIDs.empty())
+		{
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			jobClientIDs = &clientIDs;
+			jobFunction = &func;
+			jobResults.assign(clientIDs.size(), JobResult());
+			jobError = nullptr;
+			nextJob.store(0, std::memory_order_relaxed);
+
+			activeWorkers = workers.size();
+			generation++;
+		}
+		wakeWorkers.notify_all();
+
+		// The calling thread takes jobs too
+		runJobs(*arenas.back());
+
+		std::exception_ptr error;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			workersDone.wait(lock, [this] { return activeWorkers == 0; });
+
+			jobClientIDs = nullptr;
+			jobFunction = nullptr;
+			error = jobError;
+		}
+
+		// From here, the send queue fills only as fast as this thread, which the owner of the host may be
+		for (size_t job = 0; job < clientIDs.size(); job++)
+		{
+			if (jobResults[job].packet)
+			{
+				server.sendClientPacket(clientIDs[job], jobResults[job].channel, jobResults[job].packet);
+			}
+		}
+
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+	}
+
+	size_t EncodeJobSystem::getWorkerCount() const
+	{
+		return workers.size();
+	}
+
+	EncodeJobSystem::~EncodeJobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			isStopping = true;
+		}
+		wakeWorkers.notify_all();
+
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	/// <summary>
+	/// Worker thread, runs the jobs of every encode() call
+	/// </summary>
+	/// <param name="worker"></param>
+
+	void EncodeJobSystem::workerLoop(const size_t worker)
+	{
+		LNet4Byte seenGeneration = 0;
+
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wakeWorkers.wait(lock, [this, seenGeneration] { return isStopping || generation != seenGeneration; });
+
+				if (isStopping)
+				{
+					return;
+				}
+
+				seenGeneration = generation;
+			}
+
+			runJobs(*arenas[worker]);
+
+			bool isLast;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				isLast = --activeWorkers == 0;
+			}
+
+			if (isLast)
+			{
+				workersDone.notify_one();
+			}
+		}
+	}
+
+	/// <summary>
+	/// Take jobs until none are left
+	/// </summary>
+	/// <param name="arena"></param>
+
+	void EncodeJobSystem::runJobs(EncodeArena& arena)
+	{
+		const std::vector<LNet4Byte>& clientIDs = *jobClientIDs;
+
+		for (size_t job = nextJob.fetch_add(1, std::memory_order_relaxed); job < clientIDs.size();
+			job = nextJob.fetch_add(1, std::memory_order_relaxed))
+		{
+			arena.reset();
+
+			try
+			{
+				const Message* message = (*jobFunction)(clientIDs[job], arena);
+
+				if (message)
+				{
+					jobResults[job] = { message->getMsgChannel(), message->toNetworkPacket() };
+				}
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+
+				if (!jobError)
+				{
+					jobError = std::current_exception();
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,132 @@
+#ifndef LNET_ENCODE_JOBS_HPP
+#define LNET_ENCODE_JOBS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	// Bytes of one arena block, an arena grows by blocks and keeps them
+	constexpr size_t LNET_DEFAULT_ENCODE_ARENA_SIZE = 64 * 1024;
+
+	// Scratch memory of one encode worker, emptied before every job. Allocations move a pointer through blocks
+	// the worker keeps for its whole life, so encoding allocates nothing once the blocks are big enough
+	class EncodeArena
+	{
+	public:
+		EncodeArena(const size_t blockSize = LNET_DEFAULT_ENCODE_ARENA_SIZE);
+
+		EncodeArena(const EncodeArena&) = delete;
+		EncodeArena& operator=(const EncodeArena&) = delete;
+
+		// Valid until the job ends
+		void* allocate(const size_t size, const size_t alignment = alignof(std::max_align_t));
+
+		template<typename T>
+		std::span<T> allocateArray(const size_t count);
+
+		// The worker's message, its payload keeps its capacity from job to job
+		Message& message(const DeliveryMode mode, const LNetByte channel, const LNet2Byte type);
+
+		void reset();
+
+	private:
+
+		size_t blockSize;
+
+		std::vector<std::unique_ptr<LNetByte[]>> blocks;
+		size_t block;
+		size_t offset;
+
+		Message scratch;
+	};
+
+	// Encodes one packet per client on a pool of worker threads (and the calling one), each with its own arena.
+	// Every job keeps its packet in the client's slot, the calling thread hands them all to Server::sendClientPacket
+	// once every job is done, so workers never wait on the server's send queue (nor on a tick that isn't coming).
+	// Packets are created on the workers, so enet's allocator must be thread safe (malloc, the default, is)
+	class EncodeJobSystem
+	{
+	public:
+		// Encode the client's packet, returns the message to send (usually the arena's) or nullptr for nothing.
+		// Called on several threads at once
+		using LNetEncodeFunction = std::function<const Message*(const LNet4Byte& clientID, EncodeArena& arena)>;
+
+		// workerCount threads besides the one calling encode()
+		EncodeJobSystem(Server& server, const size_t workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1);
+
+		EncodeJobSystem(const EncodeJobSystem&) = delete;
+		EncodeJobSystem& operator=(const EncodeJobSystem&) = delete;
+
+		// One job per client, sends the packets from the calling thread, then rethrows the first exception a job threw
+		void encode(const std::vector<LNet4Byte>& clientIDs, const LNetEncodeFunction& func);
+
+		size_t getWorkerCount() const;
+
+		~EncodeJobSystem();
+
+	private:
+
+		// The packet a job made for its client, nullptr when it made none
+		struct JobResult
+		{
+			LNetByte channel = 0;
+			ENetPacket* packet = nullptr;
+		};
+
+		/// <summary>
+		/// Worker thread, runs the jobs of every encode() call
+		/// </summary>
+		/// <param name="worker"></param>
+		void workerLoop(const size_t worker);
+
+		/// <summary>
+		/// Take jobs until none are left
+		/// </summary>
+		/// <param name="arena"></param>
+		void runJobs(EncodeArena& arena);
+
+	private:
+
+		Server& server;
+
+		std::vector<std::thread> workers;
+
+		// One per worker, the last one is the calling thread's
+		std::vector<std::unique_ptr<EncodeArena>> arenas;
+
+		// The current encode() call
+		const std::vector<LNet4Byte>* jobClientIDs;
+		const LNetEncodeFunction* jobFunction;
+		std::vector<JobResult> jobResults;
+		std::atomic<size_t> nextJob;
+		std::exception_ptr jobError;
+
+		std::mutex mutex;
+		std::condition_variable wakeWorkers;
+		std::condition_variable workersDone;
+		LNet4Byte generation;
+		size_t activeWorkers;
+		bool isStopping;
+	};
+
+	// template arena functions
+
+	template<typename T>
+	std::span<T> EncodeArena::allocateArray(const size_t count)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Arena memory is never destroyed.");
+
+		return { static_cast<T*>(allocate(sizeof(T) * count, alignof(T))), count };
+	}
+}
+
+#endif
@@ -0,0 +1,348 @@
+#include "LNetInterestGrid.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace lnet
+{
+	InterestGrid::InterestGrid(Server& server, const float cellSize, const LNet4Byte viewCells) :
+		server(server),
+		disconnectCallback(server.addDisconnectCallback([this](const LNet4Byte& clientID) { removeClient(clientID); })),
+		cellSize(cellSize),
+		viewCells(static_cast<int32_t>(viewCells))
+	{
+		if (cellSize <= 0)
+		{
+			throw std::runtime_error("Interest grid cell size must be positive.");
+		}
+	}
+
+	// Clients, moves inside a cell are free (the server's disconnects remove them)
+
+	void InterestGrid::setClientPosition(const LNet4Byte& clientID, const float x, const float y)
+	{
+		InterestCell cell = cellOf(x, y);
+
+		auto [client, isNew] = clients.try_emplace(clientID);
+
+		if (!isNew && client->second.cell == cell)
+		{
+			client->second.x = x;
+			client->second.y = y;
+			return;
+		}
+
+		if (!isNew)
+		{
+			leaveCell(client->second.cell, clientID, true);
+			markEntitiesAround(client->second.cell);
+		}
+
+		client->second = { x, y, cell };
+
+		cells[keyOf(cell)].clients.push_back(clientID);
+		markEntitiesAround(cell);
+	}
+
+	void InterestGrid::removeClient(const LNet4Byte& clientID)
+	{
+		auto client = clients.find(clientID);
+		if (client == clients.end())
+		{
+			return;
+		}
+
+		leaveCell(client->second.cell, clientID, true);
+		markEntitiesAround(client->second.cell);
+
+		clients.erase(client);
+	}
+
+	InterestGrid::~InterestGrid()
+	{
+		server.removeDisconnectCallback(disconnectCallback);
+	}
+
+	// Entities, moves inside a cell are free
+
+	void InterestGrid::setEntityPosition(const LNet4Byte& entityID, const float x, const float y)
+	{
+		InterestCell cell = cellOf(x, y);
+
+		auto [entity, isNew] = entities.try_emplace(entityID);
+
+		if (!isNew && entity->second.position.cell == cell)
+		{
+			entity->second.position.x = x;
+			entity->second.position.y = y;
+			return;
+		}
+
+		if (!isNew)
+		{
+			leaveCell(entity->second.position.cell, entityID, false);
+		}
+
+		entity->second.position = { x, y, cell };
+		entity->second.isDirty = true;
+
+		cells[keyOf(cell)].entities.push_back(entityID);
+	}
+
+	void InterestGrid::removeEntity(const LNet4Byte& entityID)
+	{
+		auto entity = entities.find(entityID);
+		if (entity == entities.end())
+		{
+			return;
+		}
+
+		leaveCell(entity->second.position.cell, entityID, false);
+
+		entities.erase(entity);
+	}
+
+	// Clients in the view cells around the entity, empty for an unknown entity
+
+	const std::vector<LNet4Byte>& InterestGrid::getInterestedClients(const LNet4Byte& entityID)
+	{
+		static const std::vector<LNet4Byte> none;
+
+		auto entity = entities.find(entityID);
+		if (entity == entities.end())
+		{
+			return none;
+		}
+
+		Entity& data = entity->second;
+
+		if (data.isDirty)
+		{
+			data.interestedClients.clear();
+
+			for (int32_t y = data.position.cell.y - viewCells; y <= data.position.cell.y + viewCells; y++)
+			{
+				for (int32_t x = data.position.cell.x - viewCells; x <= data.position.cell.x + viewCells; x++)
+				{
+					auto cell = cells.find(keyOf({ x, y }));
+
+					if (cell != cells.end())
+					{
+						data.interestedClients.insert(data.interestedClients.end(), cell->second.clients.begin(), cell->second.clients.end());
+					}
+				}
+			}
+
+			data.isDirty = false;
+		}
+
+		return data.interestedClients;
+	}
+
+	// Looks at the occupied cells instead of the ones around the point when the radius covers more of them
+
+	std::vector<LNet4Byte> InterestGrid::getClientsInRadius(const float x, const float y, const float radius) const
+	{
+		if (!std::isfinite(radius))
+		{
+			throw std::runtime_error("Interest radius must be finite.");
+		}
+
+		std::vector<LNet4Byte> clientIDs;
+
+		if (radius < 0)
+		{
+			return clientIDs;
+		}
+
+		auto addInRange = [&](const Cell& cell)
+			{
+				for (const LNet4Byte& clientID : cell.clients)
+				{
+					const Position& position = clients.at(clientID);
+
+					float dx = position.x - x;
+					float dy = position.y - y;
+
+					if (dx * dx + dy * dy <= radius * radius)
+					{
+						clientIDs.push_back(clientID);
+					}
+				}
+			};
+
+		InterestCell first = cellOf(x - radius, y - radius);
+		InterestCell last = cellOf(x + radius, y + radius);
+
+		const double boxCells = (static_cast<double>(last.x) - first.x + 1) * (static_cast<double>(last.y) - first.y + 1);
+
+		// A map wide radius, most of its cells are empty
+		if (boxCells > static_cast<double>(cells.size()))
+		{
+			for (const auto& [key, cell] : cells)
+			{
+				addInRange(cell);
+			}
+
+			return clientIDs;
+		}
+
+		for (int32_t cellY = first.y; cellY <= last.y; cellY++)
+		{
+			for (int32_t cellX = first.x; cellX <= last.x; cellX++)
+			{
+				auto cell = cells.find(keyOf({ cellX, cellY }));
+				if (cell != cells.end())
+				{
+					addInRange(cell->second);
+				}
+			}
+		}
+
+		return clientIDs;
+	}
+
+	std::vector<LNet4Byte> InterestGrid::getClientsInCells(const std::vector<InterestCell>& cellList) const
+	{
+		std::vector<LNet4Byte> clientIDs;
+
+		for (const InterestCell& cellPosition : cellList)
+		{
+			auto cell = cells.find(keyOf(cellPosition));
+
+			if (cell != cells.end())
+			{
+				clientIDs.insert(clientIDs.end(), cell->second.clients.begin(), cell->second.clients.end());
+			}
+		}
+
+		// The same cell may be listed twice
+		std::sort(clientIDs.begin(), clientIDs.end());
+		clientIDs.erase(std::unique(clientIDs.begin(), clientIDs.end()), clientIDs.end());
+
+		return clientIDs;
+	}
+
+	InterestCell InterestGrid::cellOf(const float x, const float y) const
+	{
+		if (!std::isfinite(x) || !std::isfinite(y))
+		{
+			throw std::runtime_error("Interest grid position must be finite.");
+		}
+
+		// Clamped before the cast, a float past int32_t's range doesn't convert
+		auto coordinate = [this](const float position)
+			{
+				return static_cast<int32_t>(std::clamp(std::floor(static_cast<double>(position) / cellSize),
+					-static_cast<double>(LNET_MAX_INTEREST_CELL), static_cast<double>(LNET_MAX_INTEREST_CELL)));
+			};
+
+		return { coordinate(x), coordinate(y) };
+	}
+
+	// SEND FUNCTIONS
+
+	void InterestGrid::sendEntity(const LNet4Byte& entityID, const Message& message)
+	{
+		sendGroup(getInterestedClients(entityID), message);
+	}
+
+	void InterestGrid::sendEntityExcept(const LNet4Byte& entityID, const LNet4Byte& excludedClientID, const Message& message)
+	{
+		std::vector<LNet4Byte> clientIDs = getInterestedClients(entityID);
+
+		clientIDs.erase(std::remove(clientIDs.begin(), clientIDs.end(), excludedClientID), clientIDs.end());
+
+		sendGroup(clientIDs, message);
+	}
+
+	void InterestGrid::sendRadius(const float x, const float y, const float radius, const Message& message)
+	{
+		sendGroup(getClientsInRadius(x, y, radius), message);
+	}
+
+	void InterestGrid::sendCells(const std::vector<InterestCell>& cellList, const Message& message)
+	{
+		sendGroup(getClientsInCells(cellList), message);
+	}
+
+	/// <summary>
+	/// Hash map key of a cell
+	/// </summary>
+	/// <param name="cell"></param>
+	/// <returns></returns>
+
+	uint64_t InterestGrid::keyOf(const InterestCell& cell)
+	{
+		return (static_cast<uint64_t>(static_cast<uint32_t>(cell.x)) << 32) | static_cast<uint32_t>(cell.y);
+	}
+
+	/// <summary>
+	/// Remove an ID from a cell's list, erases the cell once it has nothing left
+	/// </summary>
+	/// <param name="cell"></param>
+	/// <param name="id"></param>
+	/// <param name="isClient"></param>
+
+	void InterestGrid::leaveCell(const InterestCell& cellPosition, const LNet4Byte& id, const bool isClient)
+	{
+		auto cell = cells.find(keyOf(cellPosition));
+		if (cell == cells.end())
+		{
+			return;
+		}
+
+		std::vector<LNet4Byte>& ids = isClient ? cell->second.clients : cell->second.entities;
+
+		auto found = std::find(ids.begin(), ids.end(), id);
+		if (found != ids.end())
+		{
+			// Order doesn't matter, swap with the last one
+			*found = ids.back();
+			ids.pop_back();
+		}
+
+		if (cell->second.clients.empty() && cell->second.entities.empty())
+		{
+			cells.erase(cell);
+		}
+	}
+
+	/// <summary>
+	/// Entities around a cell must recompute their interested clients
+	/// </summary>
+	/// <param name="cell"></param>
+
+	void InterestGrid::markEntitiesAround(const InterestCell& cellPosition)
+	{
+		for (int32_t y = cellPosition.y - viewCells; y <= cellPosition.y + viewCells; y++)
+		{
+			for (int32_t x = cellPosition.x - viewCells; x <= cellPosition.x + viewCells; x++)
+			{
+				auto cell = cells.find(keyOf({ x, y }));
+				if (cell == cells.end())
+				{
+					continue;
+				}
+
+				for (const LNet4Byte& entityID : cell->second.entities)
+				{
+					entities[entityID].isDirty = true;
+				}
+			}
+		}
+	}
+
+	/// <summary>
+	/// Send to the clients, nothing when there are none
+	/// </summary>
+	/// <param name="clientIDs"></param>
+	/// <param name="message"></param>
+
+	void InterestGrid::sendGroup(const std::vector<LNet4Byte>& clientIDs, const Message& message)
+	{
+		if (!clientIDs.empty())
+		{
+			server.sendClients(clientIDs, message);
+		}
+	}
+}
@@ -0,0 +1,135 @@
+#ifndef LNET_INTEREST_GRID_HPP
+#define LNET_INTEREST_GRID_HPP
+
+#include <unordered_map>
+#include <vector>
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	constexpr float LNET_DEFAULT_INTEREST_CELL_SIZE = 64.0f;
+
+	// Cells around an entity's cell (in every direction) whose clients are interested in it
+	constexpr LNet4Byte LNET_DEFAULT_INTEREST_VIEW_CELLS = 1;
+
+	// Farthest cell from the origin, positions past it fall in the border cells (leaves room for the view cells around them)
+	constexpr int32_t LNET_MAX_INTEREST_CELL = 1 << 30;
+
+	// A cell of the grid, position / cell size rounded down
+	struct InterestCell
+	{
+		int32_t x = 0;
+		int32_t y = 0;
+
+		bool operator==(const InterestCell& other) const = default;
+	};
+
+	// Uniform grid (a spatial hash, only occupied cells exist) of client and entity positions on a 2D plane,
+	// sends to the clients near a point, in a set of cells or interested in an entity instead of broadcasting.
+	// Every send is one packet shared by its recipients (Server::sendClients), so the fan out follows the local density.
+	// Entities cache their interested clients, only entities near a client that changed cell, or that changed cell themselves,
+	// recompute theirs. Use it from one thread
+	class InterestGrid
+	{
+	public:
+		InterestGrid(Server& server, const float cellSize = LNET_DEFAULT_INTEREST_CELL_SIZE,
+			const LNet4Byte viewCells = LNET_DEFAULT_INTEREST_VIEW_CELLS);
+
+		InterestGrid(const InterestGrid&) = delete;
+		InterestGrid& operator=(const InterestGrid&) = delete;
+
+		// Clients, moves inside a cell are free (the server's disconnects remove them)
+		void setClientPosition(const LNet4Byte& clientID, const float x, const float y);
+		void removeClient(const LNet4Byte& clientID);
+
+		// Entities, moves inside a cell are free
+		void setEntityPosition(const LNet4Byte& entityID, const float x, const float y);
+		void removeEntity(const LNet4Byte& entityID);
+
+		// Clients in the view cells around the entity, empty for an unknown entity
+		const std::vector<LNet4Byte>& getInterestedClients(const LNet4Byte& entityID);
+
+		// Looks at the occupied cells instead of the ones around the point when the radius covers more of them
+		std::vector<LNet4Byte> getClientsInRadius(const float x, const float y, const float radius) const;
+		std::vector<LNet4Byte> getClientsInCells(const std::vector<InterestCell>& cells) const;
+
+		// Throws for a position that isn't finite
+		InterestCell cellOf(const float x, const float y) const;
+
+		// SEND FUNCTIONS
+
+		void sendEntity(const LNet4Byte& entityID, const Message& message);
+		void sendEntityExcept(const LNet4Byte& entityID, const LNet4Byte& excludedClientID, const Message& message);
+		void sendRadius(const float x, const float y, const float radius, const Message& message);
+		void sendCells(const std::vector<InterestCell>& cells, const Message& message);
+
+		~InterestGrid();
+
+	private:
+
+		struct Position
+		{
+			float x = 0;
+			float y = 0;
+			InterestCell cell;
+		};
+
+		struct Cell
+		{
+			std::vector<LNet4Byte> clients;
+			std::vector<LNet4Byte> entities;
+		};
+
+		struct Entity
+		{
+			Position position;
+
+			std::vector<LNet4Byte> interestedClients;
+			bool isDirty = true;
+		};
+
+		/// <summary>
+		/// Hash map key of a cell
+		/// </summary>
+		/// <param name="cell"></param>
+		/// <returns></returns>
+		static uint64_t keyOf(const InterestCell& cell);
+
+		/// <summary>
+		/// Remove an ID from a cell's list, erases the cell once it has nothing left
+		/// </summary>
+		/// <param name="cell"></param>
+		/// <param name="id"></param>
+		/// <param name="isClient"></param>
+		void leaveCell(const InterestCell& cell, const LNet4Byte& id, const bool isClient);
+
+		/// <summary>
+		/// Entities around a cell must recompute their interested clients
+		/// </summary>
+		/// <param name="cell"></param>
+		void markEntitiesAround(const InterestCell& cell);
+
+		/// <summary>
+		/// Send to the clients, nothing when there are none
+		/// </summary>
+		/// <param name="clientIDs"></param>
+		/// <param name="message"></param>
+		void sendGroup(const std::vector<LNet4Byte>& clientIDs, const Message& message);
+
+	private:
+
+		Server& server;
+
+		// Calls removeClient for every client that disconnects
+		LNet4Byte disconnectCallback;
+
+		float cellSize;
+		int32_t viewCells;
+
+		std::unordered_map<uint64_t, Cell> cells;
+		std::unordered_map<LNet4Byte, Position> clients;
+		std::unordered_map<LNet4Byte, Entity> entities;
+	};
+}
+
+#endif
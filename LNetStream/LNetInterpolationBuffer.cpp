@@ -0,0 +1,245 @@
+#include "LNetInterpolationBuffer.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace lnet
+{
+	InterpolationBuffer::InterpolationBuffer(const size_t components, const Client* client) :
+		components(components),
+		client(client),
+		minDelay(LNET_DEFAULT_INTERPOLATION_MIN_DELAY),
+		maxDelay(LNET_DEFAULT_INTERPOLATION_MAX_DELAY),
+		maxExtrapolation(LNET_DEFAULT_MAX_EXTRAPOLATION),
+		offset(0),
+		hasOffset(false),
+		jitter(0),
+		interval(0),
+		delay(LNET_DEFAULT_INTERPOLATION_MIN_DELAY),
+		lastUpdate(0)
+	{
+	}
+
+	void InterpolationBuffer::setDelayBounds(const double newMinDelay, const double newMaxDelay)
+	{
+		minDelay = newMinDelay;
+		maxDelay = std::max(newMinDelay, newMaxDelay);
+
+		delay = std::clamp(delay, minDelay, maxDelay);
+	}
+
+	void InterpolationBuffer::setMaxExtrapolation(const double seconds)
+	{
+		maxExtrapolation = seconds;
+	}
+
+	// A state of an entity at serverTime (seconds), older than the entity's newest state is dropped
+
+	void InterpolationBuffer::push(const LNet4Byte& entityID, const double serverTime, std::span<const float> values,
+		const Clock::time_point& arrival)
+	{
+		if (values.size() != components)
+		{
+			throw std::runtime_error("Interpolated state has the wrong component count.");
+		}
+
+		Track& track = tracks[entityID];
+
+		if (track.times.empty())
+		{
+			track.times.resize(LNET_INTERPOLATION_CAPACITY);
+			track.values.resize(LNET_INTERPOLATION_CAPACITY * components);
+		}
+
+		if (track.count)
+		{
+			double newest = track.times[indexOf(track, track.count - 1)];
+
+			if (serverTime <= newest)
+			{
+				return;
+			}
+
+			// The first interval seeds the mean
+			interval += (serverTime - newest - interval) / (interval ? 16 : 1);
+		}
+
+		measureTransit(secondsOf(arrival) - serverTime);
+
+		size_t index;
+		if (track.count < LNET_INTERPOLATION_CAPACITY)
+		{
+			index = indexOf(track, track.count++);
+		}
+		else
+		{
+			// Full, the oldest makes room
+			index = track.first;
+			track.first = (track.first + 1) % LNET_INTERPOLATION_CAPACITY;
+		}
+
+		track.times[index] = serverTime;
+		std::copy(values.begin(), values.end(), track.values.begin() + index * components);
+	}
+
+	// Values of the entity at the render time, false when the entity has no state
+
+	bool InterpolationBuffer::sample(const LNet4Byte& entityID, std::span<float> values, const Clock::time_point& now) const
+	{
+		auto found = tracks.find(entityID);
+		if (found == tracks.end() || found->second.count == 0 || values.size() != components)
+		{
+			return false;
+		}
+
+		const Track& track = found->second;
+		const double renderTime = getRenderTime(now);
+
+		// The first state newer than the render time
+		size_t next = 0;
+		while (next < track.count && track.times[indexOf(track, next)] <= renderTime)
+		{
+			next++;
+		}
+
+		size_t from;
+		size_t to;
+		double t;
+
+		if (next == 0 || track.count == 1)
+		{
+			// Before every state, or nothing to blend with
+			size_t index = indexOf(track, next == 0 ? 0 : track.count - 1);
+			std::copy_n(track.values.begin() + index * components, components, values.begin());
+			return true;
+		}
+		else if (next < track.count)
+		{
+			from = indexOf(track, next - 1);
+			to = indexOf(track, next);
+			t = (renderTime - track.times[from]) / (track.times[to] - track.times[from]);
+		}
+		else
+		{
+			// Past the newest state, carry on along the last two for a little while
+			from = indexOf(track, track.count - 2);
+			to = indexOf(track, track.count - 1);
+
+			double extrapolated = std::min(renderTime - track.times[to], maxExtrapolation);
+			t = 1 + extrapolated / (track.times[to] - track.times[from]);
+		}
+
+		for (size_t component = 0; component < components; component++)
+		{
+			float a = track.values[from * components + component];
+			float b = track.values[to * components + component];
+
+			values[component] = static_cast<float>(a + (b - a) * t);
+		}
+
+		return true;
+	}
+
+	// Move the delay towards what the jitter asks for, once a frame before sampling
+
+	void InterpolationBuffer::update(const Clock::time_point& now)
+	{
+		double seconds = secondsOf(now);
+		double elapsed = lastUpdate ? seconds - lastUpdate : 0;
+		lastUpdate = seconds;
+
+		double deviation = jitter;
+		if (client)
+		{
+			// enet's round trip variance covers both ways, a state only travels one
+			deviation = std::max(deviation, client->getStats().roundTripTimeVariance / 2000.0);
+		}
+
+		double target = std::clamp(interval + LNET_INTERPOLATION_JITTER_FACTOR * deviation, minDelay, maxDelay);
+		double step = elapsed * LNET_INTERPOLATION_SLEW;
+
+		delay += std::clamp(target - delay, -step, step);
+	}
+
+	void InterpolationBuffer::removeEntity(const LNet4Byte& entityID)
+	{
+		tracks.erase(entityID);
+	}
+
+	void InterpolationBuffer::clear()
+	{
+		tracks.clear();
+
+		hasOffset = false;
+		jitter = 0;
+		interval = 0;
+	}
+
+	// Server time sampled now
+
+	double InterpolationBuffer::getRenderTime(const Clock::time_point& now) const
+	{
+		return secondsOf(now) - offset - delay;
+	}
+
+	// Seconds
+
+	double InterpolationBuffer::getDelay() const
+	{
+		return delay;
+	}
+
+	double InterpolationBuffer::getJitter() const
+	{
+		return jitter;
+	}
+
+	/// <summary>
+	/// Seconds of a local time point
+	/// </summary>
+	/// <param name="time"></param>
+	/// <returns></returns>
+
+	double InterpolationBuffer::secondsOf(const Clock::time_point& time)
+	{
+		return std::chrono::duration<double>(time.time_since_epoch()).count();
+	}
+
+	/// <summary>
+	/// Ring index of the track's nth oldest state
+	/// </summary>
+	/// <param name="track"></param>
+	/// <param name="nth"></param>
+	/// <returns></returns>
+
+	size_t InterpolationBuffer::indexOf(const Track& track, const size_t nth)
+	{
+		return (track.first + nth) % LNET_INTERPOLATION_CAPACITY;
+	}
+
+	/// <summary>
+	/// Fold a state's transit time (arrival - server time) into the offset and jitter
+	/// </summary>
+	/// <param name="transit"></param>
+
+	void InterpolationBuffer::measureTransit(const double transit)
+	{
+		if (!hasOffset)
+		{
+			offset = transit;
+			hasOffset = true;
+			return;
+		}
+
+		if (transit < offset)
+		{
+			offset = transit;
+		}
+		else
+		{
+			// Creep up slowly so a route that got slower for good is followed
+			offset += std::min(transit - offset, jitter + 0.001) / 256;
+		}
+
+		jitter += (std::abs(transit - offset) - jitter) / 16;
+	}
+}
@@ -0,0 +1,119 @@
+#ifndef LNET_INTERPOLATION_BUFFER_HPP
+#define LNET_INTERPOLATION_BUFFER_HPP
+
+#include <chrono>
+#include <span>
+#include <unordered_map>
+#include <vector>
+#include "LNetClient.hpp"
+
+namespace lnet
+{
+	// States kept per entity
+	constexpr size_t LNET_INTERPOLATION_CAPACITY = 32;
+
+	// Bounds of the render delay, seconds
+	constexpr double LNET_DEFAULT_INTERPOLATION_MIN_DELAY = 0.01;
+	constexpr double LNET_DEFAULT_INTERPOLATION_MAX_DELAY = 0.5;
+
+	// How far past the newest state values are extrapolated, seconds
+	constexpr double LNET_DEFAULT_MAX_EXTRAPOLATION = 0.1;
+
+	// Jitter deviations the delay covers on top of the interval between states
+	constexpr double LNET_INTERPOLATION_JITTER_FACTOR = 2.0;
+
+	// Share of the elapsed time the delay may change by, so the render time never jumps
+	constexpr double LNET_INTERPOLATION_SLEW = 0.1;
+
+	// Smooths received entity states for rendering. Every state is pushed with the server time it describes
+	// (a tick time, a snapshot sequence times the tick interval, Client clock sync...) and timestamped when it arrives.
+	// Values are interpolated at a render time a delay behind the newest states, the delay follows the measured
+	// transit jitter (and the connection's round trip variance when a client is given): as low as stays smooth.
+	// States are float components, the same count for every entity. Use it from one thread
+	class InterpolationBuffer
+	{
+	public:
+		using Clock = std::chrono::steady_clock;
+
+		InterpolationBuffer(const size_t components, const Client* client = nullptr);
+
+		void setDelayBounds(const double minDelay, const double maxDelay);
+		void setMaxExtrapolation(const double seconds);
+
+		// A state of an entity at serverTime (seconds), older than the entity's newest state is dropped
+		void push(const LNet4Byte& entityID, const double serverTime, std::span<const float> values,
+			const Clock::time_point& arrival = Clock::now());
+
+		// Values of the entity at the render time, false when the entity has no state
+		bool sample(const LNet4Byte& entityID, std::span<float> values, const Clock::time_point& now = Clock::now()) const;
+
+		// Move the delay towards what the jitter asks for, once a frame before sampling
+		void update(const Clock::time_point& now = Clock::now());
+
+		void removeEntity(const LNet4Byte& entityID);
+		void clear();
+
+		// Server time sampled now
+		double getRenderTime(const Clock::time_point& now = Clock::now()) const;
+
+		// Seconds
+		double getDelay() const;
+		double getJitter() const;
+
+	private:
+
+		struct Track
+		{
+			// Ring of states, oldest at first
+			std::vector<double> times;
+			std::vector<float> values;
+			size_t first = 0;
+			size_t count = 0;
+		};
+
+		/// <summary>
+		/// Seconds of a local time point
+		/// </summary>
+		/// <param name="time"></param>
+		/// <returns></returns>
+		static double secondsOf(const Clock::time_point& time);
+
+		/// <summary>
+		/// Ring index of the track's nth oldest state
+		/// </summary>
+		/// <param name="track"></param>
+		/// <param name="nth"></param>
+		/// <returns></returns>
+		static size_t indexOf(const Track& track, const size_t nth);
+
+		/// <summary>
+		/// Fold a state's transit time (arrival - server time) into the offset and jitter
+		/// </summary>
+		/// <param name="transit"></param>
+		void measureTransit(const double transit);
+
+	private:
+
+		size_t components;
+		const Client* client;
+
+		double minDelay;
+		double maxDelay;
+		double maxExtrapolation;
+
+		// Smallest transit seen lately, local time = server time + offset for the fastest state
+		double offset;
+		bool hasOffset;
+
+		// Mean deviation of the transit from the offset, and mean interval between states of an entity
+		double jitter;
+		double interval;
+
+		double delay;
+		double lastUpdate;
+
+		std::unordered_map<LNet4Byte, Track> tracks;
+	};
+}
+
+#endif
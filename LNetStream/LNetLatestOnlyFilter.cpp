@@ -0,0 +1,61 @@
+#include "LNetLatestOnlyFilter.hpp"
+
+namespace lnet
+{
+	// true when the message is newer than every message of its channel and type accepted so far
+
+	bool LatestOnlyFilter::accept(const Message& message)
+	{
+		auto result = latestSequences.try_emplace(message.getMsgIdentifier(), message.getSequence());
+
+		// First of its kind
+		if (result.second)
+		{
+			return true;
+		}
+
+		// Sequences wrap around, newer means less than half the range ahead
+		LNet2Byte& latest = result.first->second;
+		if (static_cast<int16_t>(message.getSequence() - latest) <= 0)
+		{
+			return false;
+		}
+
+		latest = message.getSequence();
+
+		return true;
+	}
+
+	void LatestOnlyFilter::clear()
+	{
+		latestSequences.clear();
+	}
+
+	// The sequence the next message of this channel and type gets
+
+	LNet2Byte LatestOnlySequencer::peek(const MessageIdentifier& identifier) const
+	{
+		auto next = nextSequences.find(identifier);
+
+		return next != nextSequences.end() ? next->second : 0;
+	}
+
+	// Give out sequence, the next one is sequence + 1
+
+	void LatestOnlySequencer::take(const MessageIdentifier& identifier, const LNet2Byte& sequence)
+	{
+		nextSequences[identifier] = static_cast<LNet2Byte>(sequence + 1);
+	}
+
+	void LatestOnlySequencer::clear()
+	{
+		nextSequences.clear();
+	}
+
+	// Whether a is after b, sequences wrap around
+
+	bool LatestOnlySequencer::isNewer(const LNet2Byte& a, const LNet2Byte& b)
+	{
+		return static_cast<int16_t>(a - b) > 0;
+	}
+}
@@ -0,0 +1,46 @@
+#ifndef LNET_LATEST_ONLY_FILTER_HPP
+#define LNET_LATEST_ONLY_FILTER_HPP
+
+#include <unordered_map>
+#include "LNetMessage.hpp"
+
+namespace lnet
+{
+	// Receiver side of DeliveryMode::LatestOnly, remembers the newest sequence seen per channel and type of one sender
+	class LatestOnlyFilter
+	{
+	public:
+		// true when the message is newer than every message of its channel and type accepted so far
+		bool accept(const Message& message);
+
+		void clear();
+
+	private:
+		std::unordered_map<MessageIdentifier, LNet2Byte, HashMessageIdentifier> latestSequences;
+	};
+
+	// A packet shared by several peers carries the newest of their sequences, a peer further behind than this gets its own copy
+	constexpr LNet2Byte LNET_LATEST_ONLY_MAX_JUMP = 0x4000;
+
+	// Sender side of DeliveryMode::LatestOnly, the next sequence per channel and type sent to one peer,
+	// so each of the peer's filters sees its sequence move by one per message (never half the range at once)
+	class LatestOnlySequencer
+	{
+	public:
+		// The sequence the next message of this channel and type gets
+		LNet2Byte peek(const MessageIdentifier& identifier) const;
+
+		// Give out sequence, the next one is sequence + 1
+		void take(const MessageIdentifier& identifier, const LNet2Byte& sequence);
+
+		void clear();
+
+		// Whether a is after b, sequences wrap around
+		static bool isNewer(const LNet2Byte& a, const LNet2Byte& b);
+
+	private:
+		std::unordered_map<MessageIdentifier, LNet2Byte, HashMessageIdentifier> nextSequences;
+	};
+}
+
+#endif
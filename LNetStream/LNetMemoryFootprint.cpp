@@ -0,0 +1,55 @@
+#include "LNetMemoryFootprint.hpp"
+
+namespace lnet
+{
+	size_t MemoryFootprint::totalBytes() const
+	{
+		return hostBytes + peerBytes + channelBytes;
+	}
+
+	// One peer (its slot and its channels)
+
+	MemoryFootprint MemoryFootprint::ofPeer(const ENetPeer* peer)
+	{
+		MemoryFootprint footprint;
+
+		if (!peer)
+		{
+			return footprint;
+		}
+
+		footprint.peerBytes = sizeof(ENetPeer);
+
+		// enet frees the channels when the peer resets
+		if (peer->channels)
+		{
+			footprint.channelBytes = peer->channelCount * sizeof(ENetChannel);
+		}
+
+		return footprint;
+	}
+
+	// A host with every peer slot
+
+	MemoryFootprint MemoryFootprint::ofHost(const ENetHost* host)
+	{
+		MemoryFootprint footprint;
+
+		if (!host)
+		{
+			return footprint;
+		}
+
+		footprint.hostBytes = sizeof(ENetHost);
+
+		for (const ENetPeer* peer = host->peers; peer < &host->peers[host->peerCount]; ++peer)
+		{
+			MemoryFootprint peerFootprint = ofPeer(peer);
+
+			footprint.peerBytes += peerFootprint.peerBytes;
+			footprint.channelBytes += peerFootprint.channelBytes;
+		}
+
+		return footprint;
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef LNET_MEMORY_FOOTPRINT_HPP
+#define LNET_MEMORY_FOOTPRINT_HPP
+
+#include <enet/enet.h>
+#include <cstddef>
+
+namespace lnet
+{
+	// Bytes enet keeps for its bookkeeping (queued packets not included)
+	struct MemoryFootprint
+	{
+		// The ENetHost
+		size_t hostBytes = 0;
+
+		// ENetPeer slots, allocated for every slot when the host is created
+		size_t peerBytes = 0;
+
+		// ENetChannel state, allocated per connected peer for every channel it negotiated
+		size_t channelBytes = 0;
+
+		size_t totalBytes() const;
+
+		// One peer (its slot and its channels)
+		static MemoryFootprint ofPeer(const ENetPeer* peer);
+
+		// A host with every peer slot
+		static MemoryFootprint ofHost(const ENetHost* host);
+	};
+}
+
+#endif
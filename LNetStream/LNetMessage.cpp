@@ -1,41 +1,55 @@
 #include "LNetMessage.hpp"
+#include "LNetAggregator.hpp"
 
 namespace lnet
 {
 	// GETTERS AND SETTERS
 
-	Message::Message(const LNetByte* arr, const size_t& length) : isReliable(true)
+	Message::Message(const LNetByte* arr, const size_t& length) : deliveryMode(DeliveryMode::Reliable)
 	{
-		// copy from memory the first value, type (as size can be calculated)
-		std::memcpy(&identifier.type, arr, LNET_TYPE_SIZE);
+		size_t headerSize = readNetworkHeader(arr, length);
 
-		identifier.type = LNetEndiannessHandler::fromNetworkEndian(identifier.type);
-
-		size_t payloadSize = length - LNET_TYPE_SIZE;
-
-		if (payloadSize > 0)
-		{
-			payload.resize(payloadSize);
-			std::memcpy(payload.data(), arr + LNET_TYPE_SIZE, payload.size());
-		}
+		payload.assign(arr + headerSize, arr + length);
 	}
 
-	Message::Message(const LNetByte* arr, const size_t& length, const LNetByte& channel) : isReliable(true)
+	Message::Message(const LNetByte* arr, const size_t& length, const LNetByte& channel) : deliveryMode(DeliveryMode::Reliable)
 	{
 		identifier.channel = channel;
 
-		// copy from memory the first 2 values, type and size
-		std::memcpy(&identifier.type, arr, LNET_TYPE_SIZE);
+		size_t headerSize = readNetworkHeader(arr, length);
 
-		identifier.type = LNetEndiannessHandler::fromNetworkEndian(identifier.type);
+		payload.assign(arr + headerSize, arr + length);
+	}
+
+	Message::Message(ENetPacket* packet, const LNetByte& channel) :
+		Message(std::shared_ptr<ENetPacket>(packet, enet_packet_destroy), packet->data, packet->dataLength, channel)
+	{ }
 
-		size_t payloadSize = length - LNET_TYPE_SIZE;
+	// Borrow a message's network form out of a received packet (one packet can hold several messages)
 
-		if (payloadSize > 0)
+	Message::Message(const std::shared_ptr<ENetPacket>& packet, const LNetByte* data, const size_t length, const LNetByte& channel) :
+		packet(packet)
+	{
+		identifier.channel = channel;
+
+		// what enet delivered it as, unless the header says it's LatestOnly
+		if (packet->flags & ENET_PACKET_FLAG_RELIABLE)
+		{
+			deliveryMode = DeliveryMode::Reliable;
+		}
+		else if (packet->flags & ENET_PACKET_FLAG_UNSEQUENCED)
+		{
+			deliveryMode = DeliveryMode::Unsequenced;
+		}
+		else
 		{
-			payload.resize(payloadSize);
-			std::memcpy(payload.data(), arr + LNET_TYPE_SIZE, payload.size());
+			deliveryMode = DeliveryMode::Unreliable;
 		}
+
+		size_t headerSize = readNetworkHeader(data, length);
+
+		borrowedPayload = data + headerSize;
+		borrowedSize = length - headerSize;
 	}
 
 	void Message::setMsgChannel(const LNetByte value)
@@ -50,12 +64,18 @@ namespace lnet
 
 	void Message::setMsgSize(const LNet4Byte value)
 	{
+		ownPayload();
 		payload.resize(value);
 	}
 
 	void Message::setIsReliable(const bool value)
 	{
-		isReliable = value;
+		deliveryMode = toDeliveryMode(value);
+	}
+
+	void Message::setDeliveryMode(const DeliveryMode value)
+	{
+		deliveryMode = value;
 	}
 
 	MessageIdentifier Message::getMsgIdentifier() const
@@ -76,52 +96,323 @@ namespace lnet
 
 	LNet4Byte Message::getMsgSize() const
 	{
-		return payload.size() + LNET_TYPE_SIZE;
+		return payloadSize() + networkHeaderSize();
 	}
 
 	bool Message::getIsReliable() const
 	{
-		return isReliable;
+		return deliveryMode == DeliveryMode::Reliable;
+	}
+
+	DeliveryMode Message::getDeliveryMode() const
+	{
+		return deliveryMode;
+	}
+
+	LNet2Byte Message::getSequence() const
+	{
+		return sequence;
+	}
+
+	// STATIC
+
+	DeliveryMode Message::toDeliveryMode(const bool isReliable)
+	{
+		return isReliable ? DeliveryMode::Reliable : DeliveryMode::Unreliable;
 	}
 
-	const std::vector<LNetByte>& Message::getPayload() const
+	bool Message::isNetworkMessage(const LNetByte* data, const size_t length)
 	{
-		return payload;
+		MessageIdentifier identifier;
+		LNet2Byte sequence;
+		DeliveryMode deliveryMode;
+
+		return parseNetworkHeader(data, length, identifier, sequence, deliveryMode) > 0;
+	}
+
+	// Put a channel escape in front of a packet's message, takes the packet and returns the new one
+
+	ENetPacket* Message::toChannelEscapedPacket(ENetPacket* packet, const LNetByte& channel)
+	{
+		ENetPacket* escaped = channelEscapedCopy(packet, channel);
+
+		enet_packet_destroy(packet);
+
+		if (!escaped)
+		{
+			throw std::runtime_error("Couldn't create packet.");
+		}
+
+		return escaped;
+	}
+
+	// A new packet with a channel escape in front of the packet's message, the packet stays the caller's (nullptr when it couldn't be created)
+
+	ENetPacket* Message::channelEscapedCopy(const ENetPacket* packet, const LNetByte& channel)
+	{
+		ENetPacket* escaped = enet_packet_create(nullptr, LNET_CHANNEL_ESCAPE_HEADER_SIZE + packet->dataLength, packet->flags);
+
+		if (!escaped)
+		{
+			return nullptr;
+		}
+
+		LNet2Byte netEscape = LNetEndiannessHandler::toNetworkEndian(LNET_TYPE_CHANNEL_ESCAPE);
+		std::memcpy(escaped->data, &netEscape, LNET_TYPE_SIZE);
+		escaped->data[LNET_TYPE_SIZE] = channel;
+		std::memcpy(escaped->data + LNET_CHANNEL_ESCAPE_HEADER_SIZE, packet->data, packet->dataLength);
+
+		return escaped;
+	}
+
+	bool Message::isNetworkContainer(const LNetByte* data, const size_t length)
+	{
+		if (length < LNET_TYPE_SIZE)
+		{
+			return false;
+		}
+
+		LNet2Byte type;
+		std::memcpy(&type, data, LNET_TYPE_SIZE);
+
+		return LNetEndiannessHandler::fromNetworkEndian(type) == LNET_TYPE_CONTAINER;
+	}
+
+	// The messages of a received container packet, they borrow their payloads from it and own it from now on
+
+	std::vector<Message> Message::fromContainerPacket(ENetPacket* packet, const LNetByte& channel)
+	{
+		std::shared_ptr<ENetPacket> shared(packet, enet_packet_destroy);
+
+		std::vector<Message> messages;
+
+		const LNetByte* position = packet->data + LNET_TYPE_SIZE;
+		const LNetByte* end = packet->data + packet->dataLength;
+
+		while (position < end)
+		{
+			size_t length;
+			size_t lengthSize = Aggregator::readLength(position, end - position, length);
+
+			if (lengthSize == 0 || length > static_cast<size_t>(end - position) - lengthSize)
+			{
+				break;
+			}
+
+			position += lengthSize;
+
+			// Containers don't nest
+			if (!isNetworkMessage(position, length) || isNetworkContainer(position, length))
+			{
+				break;
+			}
+
+			messages.push_back(Message(shared, position, length, channel));
+			position += length;
+		}
+
+		return messages;
+	}
+
+	enet_uint32 Message::toPacketFlags(const DeliveryMode deliveryMode)
+	{
+		switch (deliveryMode)
+		{
+		case DeliveryMode::Reliable:
+			return ENET_PACKET_FLAG_RELIABLE;
+		case DeliveryMode::Unreliable:
+			return 0;
+		case DeliveryMode::Unsequenced:
+		case DeliveryMode::LatestOnly:
+			return ENET_PACKET_FLAG_UNSEQUENCED;
+		case DeliveryMode::UnreliableFragment:
+			return ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT;
+		default:
+			throw std::runtime_error("Undefined Delivery Mode");
+		}
+	}
+
+	// The type of a LatestOnly packet made by toNetworkPacket (before any channel escape), false for other packets
+
+	bool Message::latestOnlyTypeOf(const ENetPacket* packet, LNet2Byte& type)
+	{
+		if (packet->dataLength < LNET_LATEST_ONLY_HEADER_SIZE)
+		{
+			return false;
+		}
+
+		LNet2Byte marker;
+		std::memcpy(&marker, packet->data, LNET_TYPE_SIZE);
+
+		if (LNetEndiannessHandler::fromNetworkEndian(marker) != LNET_TYPE_LATEST_ONLY)
+		{
+			return false;
+		}
+
+		std::memcpy(&type, packet->data + LNET_TYPE_SIZE, LNET_TYPE_SIZE);
+		type = LNetEndiannessHandler::fromNetworkEndian(type);
+
+		return true;
+	}
+
+	// Write the sequence of such a packet, senders stamp it for the peer it goes to
+
+	void Message::setLatestOnlySequence(ENetPacket* packet, const LNet2Byte& sequence)
+	{
+		LNet2Byte netSequence = LNetEndiannessHandler::toNetworkEndian(sequence);
+
+		std::memcpy(packet->data + LNET_TYPE_SIZE * 2, &netSequence, LNET_SEQUENCE_SIZE);
+	}
+
+	std::span<const LNetByte> Message::getPayload() const
+	{
+		return { payloadData(), payloadSize() };
 	}
 
 	// Prepare data for network transmission (converts header to network byte order, and gives a shared ptr to a vector with all the data)
 
 	const std::shared_ptr<std::vector<LNetByte>> Message::toNetworkBuffer() const
 	{
-		// I hope it resizes it
 		std::shared_ptr<std::vector<LNetByte>> buffer =
-			std::make_shared< std::vector<LNetByte>>(LNET_TYPE_SIZE + payload.size());
+			std::make_shared< std::vector<LNetByte>>(getMsgSize());
+
+		writeNetworkBytes(buffer->data());
+
+		return buffer;
+	}
+
+	ENetPacket* Message::toNetworkPacket() const
+	{
+		// Let enet allocate the packet at its final size (no data given = nothing copied), then serialize straight into it
+		ENetPacket* packet = enet_packet_create(
+			nullptr,
+			getMsgSize(),
+			toPacketFlags(deliveryMode)
+		);
+
+		if (!packet)
+		{
+			throw std::runtime_error("Couldn't create packet.");
+		}
+
+		writeNetworkBytes(packet->data);
 
+		return packet;
+	}
+
+	// Write the network form of the message (network order header, then the payload) to destination, which has getMsgSize() bytes
+
+	void Message::writeNetworkBytes(LNetByte* destination) const
+	{
 		// Create a network order header using the EndiannessHandler
 		LNet2Byte netType = LNetEndiannessHandler::toNetworkEndian(identifier.type);
 
-		memcpy(buffer->data(), &netType, LNET_TYPE_SIZE);
+		if (deliveryMode == DeliveryMode::LatestOnly)
+		{
+			LNet2Byte netMarker = LNetEndiannessHandler::toNetworkEndian(LNET_TYPE_LATEST_ONLY);
+			// Stamped per peer when the packet is sent (setLatestOnlySequence)
+			LNet2Byte netSequence = 0;
 
-		if (readPosition < payload.size())
+			std::memcpy(destination, &netMarker, LNET_TYPE_SIZE);
+			std::memcpy(destination + LNET_TYPE_SIZE, &netType, LNET_TYPE_SIZE);
+			std::memcpy(destination + LNET_TYPE_SIZE * 2, &netSequence, LNET_SEQUENCE_SIZE);
+		}
+		else
 		{
-			memcpy(buffer->data() + LNET_TYPE_SIZE, payload.data(), payload.size() - readPosition);
+			std::memcpy(destination, &netType, LNET_TYPE_SIZE);
 		}
 
-		return buffer;
+		if (payloadSize() > 0)
+		{
+			std::memcpy(destination + networkHeaderSize(), payloadData(), payloadSize());
+		}
+
+		MessageSizeHints::record(identifier.type, payloadSize());
 	}
 
-	ENetPacket* Message::toNetworkPacket() const
+
+	// Read the header of a message's network form (channel escape, type, and the sequence of a LatestOnly message), returns its size
+
+	size_t Message::readNetworkHeader(const LNetByte* data, const size_t length)
 	{
-		auto buffer = toNetworkBuffer();
+		size_t headerSize = parseNetworkHeader(data, length, identifier, sequence, deliveryMode);
 
-		// I hope it resizes it
-		ENetPacket* packet = enet_packet_create(
-			buffer->data(),
-			buffer->size(),
-			isReliable ? ENET_PACKET_FLAG_RELIABLE : 0
-		);
+		if (headerSize == 0)
+		{
+			throw std::runtime_error("Packet is too small to hold a message.");
+		}
 
-		return packet;
+		return headerSize;
+	}
+
+	// Parse [channel escape][latest only escape][type] at the start of data, returns the header size, 0 when data is too small for it
+
+	size_t Message::parseNetworkHeader(const LNetByte* data, const size_t length, MessageIdentifier& identifier, LNet2Byte& sequence, DeliveryMode& deliveryMode)
+	{
+		size_t position = 0;
+		LNet2Byte type;
+
+		if (!readNetworkType(data, length, position, type))
+		{
+			return 0;
+		}
+
+		if (type == LNET_TYPE_CHANNEL_ESCAPE)
+		{
+			if (length < position + LNET_CHANNEL_SIZE)
+			{
+				return 0;
+			}
+
+			identifier.channel = data[position];
+			position += LNET_CHANNEL_SIZE;
+
+			if (!readNetworkType(data, length, position, type))
+			{
+				return 0;
+			}
+		}
+
+		if (type == LNET_TYPE_LATEST_ONLY)
+		{
+			if (!readNetworkType(data, length, position, type) || length < position + LNET_SEQUENCE_SIZE)
+			{
+				return 0;
+			}
+
+			std::memcpy(&sequence, data + position, LNET_SEQUENCE_SIZE);
+			sequence = LNetEndiannessHandler::fromNetworkEndian(sequence);
+			position += LNET_SEQUENCE_SIZE;
+
+			deliveryMode = DeliveryMode::LatestOnly;
+		}
+
+		identifier.type = type;
+
+		return position;
+	}
+
+	// Read a network order type at position and move past it, false when data is too small
+
+	bool Message::readNetworkType(const LNetByte* data, const size_t length, size_t& position, LNet2Byte& type)
+	{
+		if (length < position + LNET_TYPE_SIZE)
+		{
+			return false;
+		}
+
+		std::memcpy(&type, data + position, LNET_TYPE_SIZE);
+		type = LNetEndiannessHandler::fromNetworkEndian(type);
+		position += LNET_TYPE_SIZE;
+
+		return true;
+	}
+
+	// Size of the network header this message is sent with
+
+	size_t Message::networkHeaderSize() const
+	{
+		return deliveryMode == DeliveryMode::LatestOnly ? LNET_LATEST_ONLY_HEADER_SIZE : LNET_TYPE_SIZE;
 	}
 
 
@@ -132,6 +423,8 @@ namespace lnet
 
 	Message& Message::operator<<(const std::string& value)
 	{
+		ownPayload();
+
 		size_t sizeBefore = payload.size();
 		payload.resize(sizeBefore + (value.length() + 1));
 
@@ -144,6 +437,8 @@ namespace lnet
 
 	Message& Message::operator<<(const char* value)
 	{
+		ownPayload();
+
 		size_t sizeBefore = payload.size();
 		payload.resize(sizeBefore + (std::strlen(value) + 1));
 
@@ -152,6 +447,23 @@ namespace lnet
 		return *this;
 	}
 
+	// Input raw bytes (no size in front)
+
+	Message& Message::writeBytes(const void* data, const size_t size)
+	{
+		ownPayload();
+
+		size_t sizeBefore = payload.size();
+		payload.resize(sizeBefore + size);
+
+		if (size > 0)
+		{
+			std::memcpy(payload.data() + sizeBefore, data, size);
+		}
+
+		return *this;
+	}
+
 	// Define input size
 
 	Message& Message::operator<<(const MessageSizes size)
@@ -168,22 +480,49 @@ namespace lnet
 
 	Message& Message::operator>>(std::string& value)
 	{
-		size_t sizeBefore = payload.size();
-		auto nullTermPos = std::find(payload.begin() + readPosition, payload.end(), '\0');
+		const LNetByte* begin = payloadData() + readPosition;
+		const LNetByte* end = payloadData() + payloadSize();
+		const LNetByte* nullTermPos = std::find(begin, end, '\0');
 
-		if (nullTermPos == payload.end())
+		if (nullTermPos == end)
 		{
 			throw std::runtime_error("No null terminator found, string is incomplete.");
 		}
 
-		size_t stringLength = nullTermPos - (payload.begin() + readPosition);
-		value.assign(reinterpret_cast<const char*>(payload.data() + readPosition), stringLength);
+		size_t stringLength = nullTermPos - begin;
+		value.assign(reinterpret_cast<const char*>(begin), stringLength);
 
 		readPosition += stringLength + 1;
 
 		return *this;
 	}
 
+	// Output raw bytes (no size in front)
+
+	Message& Message::readBytes(void* data, const size_t size)
+	{
+		if (size > getReadRemaining())
+		{
+			throw std::runtime_error("Not enough data in payload to extract bytes.");
+		}
+
+		if (size > 0)
+		{
+			std::memcpy(data, payloadData() + readPosition, size);
+		}
+
+		readPosition += size;
+
+		return *this;
+	}
+
+	// Bytes left to output
+
+	size_t Message::getReadRemaining() const
+	{
+		return payloadSize() - readPosition;
+	}
+
 	// Define output size
 
 	Message& Message::operator>>(const MessageSizes size)
@@ -198,9 +537,38 @@ namespace lnet
 
 	void Message::reset(LNetByte channel, LNet2Byte type)
 	{
-		identifier.channel = 0;
-		identifier.type = 0;
+		identifier.channel = channel;
+		identifier.type = type;
 		payload.clear();
+		packet.reset();
+		borrowedPayload = nullptr;
+		borrowedSize = 0;
+		readPosition = 0;
+
+		reserveBySizeHint();
+	}
+
+	// Copy a borrowed payload into the owned one (before writing to it) and let go of the packet
+
+	void Message::copyBorrowedPayload()
+	{
+		payload.assign(borrowedPayload, borrowedPayload + borrowedSize);
+
+		packet.reset();
+		borrowedPayload = nullptr;
+		borrowedSize = 0;
+	}
+
+	// Reserve the payload capacity messages of this type usually end up with
+
+	void Message::reserveBySizeHint()
+	{
+		size_t hint = MessageSizeHints::get(identifier.type);
+
+		if (hint > payload.capacity())
+		{
+			payload.reserve(hint);
+		}
 	}
 
 	// Print
@@ -213,7 +581,7 @@ namespace lnet
 			"-----------------------------------------------\n"\
 			"PAYLOAD: \n";
 
-		for (const auto& byte : msg.payload) {
+		for (const auto& byte : msg.getPayload()) {
 			os << std::hex << std::setw(2) << std::setfill('0') << (int)byte << " ";
 		}
 
@@ -7,7 +7,9 @@
 #include <cstdint>
 #include <memory>
 #include <iomanip>
+#include <span>
 #include "LNetEndianHandler.hpp"
+#include "LNetMessageSizeHints.hpp"
 #include <functional>
 
 namespace lnet
@@ -34,14 +36,40 @@ namespace lnet
 	{
 		std::size_t operator()(const MessageIdentifier& identifier) const
 		{
-			return std::hash<LNet2Byte>()(identifier.type) ^ 
-				std::hash<LNetByte>()(identifier.channel);
+			// channel and type side by side, so no two identifiers collide
+			return std::hash<LNet4Byte>()((static_cast<LNet4Byte>(identifier.channel) << 16) | identifier.type);
 		}
 	};
 
 
 	constexpr size_t LNET_CHANNEL_SIZE = 1;
 	constexpr size_t LNET_TYPE_SIZE = 2;
+	constexpr size_t LNET_SEQUENCE_SIZE = 2;
+
+	// Types from here up are used by the library itself on the wire, user messages should stay below
+	constexpr LNet2Byte LNET_RESERVED_TYPE_BEGIN = 0xFF00;
+
+	// [LNET_TYPE_LATEST_ONLY][type][sequence][payload], a DeliveryMode::LatestOnly message
+	constexpr LNet2Byte LNET_TYPE_LATEST_ONLY = 0xFFFE;
+	constexpr size_t LNET_LATEST_ONLY_HEADER_SIZE = LNET_TYPE_SIZE + LNET_TYPE_SIZE + LNET_SEQUENCE_SIZE;
+
+	// [LNET_TYPE_CHANNEL_ESCAPE][channel][message], a message on a channel the peer has no enet channel for,
+	// carried over channel % enet channel count (see ServerSettings::physicalChannels)
+	constexpr LNet2Byte LNET_TYPE_CHANNEL_ESCAPE = 0xFFFD;
+	constexpr size_t LNET_CHANNEL_ESCAPE_HEADER_SIZE = LNET_TYPE_SIZE + LNET_CHANNEL_SIZE;
+
+	// [LNET_TYPE_CONTAINER][size][message][size][message]..., several messages sent in one packet (see Aggregator)
+	constexpr LNet2Byte LNET_TYPE_CONTAINER = 0xFFFF;
+
+	// How a message travels, maps to enet's packet flags
+	enum class DeliveryMode
+	{
+		Reliable,           // Resent until delivered, in order
+		Unreliable,         // May be lost, enet drops it if a newer one on the channel arrived first
+		Unsequenced,        // May be lost or arrive in any order, never waits behind other packets
+		UnreliableFragment, // Like Unreliable, but a message bigger than the MTU is fragmented unreliably too
+		LatestOnly,         // Unsequenced, and the receiver drops it if a newer message of its channel and type arrived first
+	};
 
 	enum class MessageSizes
 	{
@@ -55,34 +83,45 @@ namespace lnet
 	public:
 		// CONSTRUCTORS
 		
-		Message() : isReliable(true) {}  // Default constructor
+		Message() : deliveryMode(DeliveryMode::Reliable) { reserveBySizeHint(); }  // Default constructor
+
+		Message(const LNet2Byte type, const LNetByte channel = 0) : deliveryMode(DeliveryMode::Reliable), identifier{ channel, type} { reserveBySizeHint(); }
+
+		Message(const bool isReliable, const LNetByte channel, const LNet2Byte type) : deliveryMode(toDeliveryMode(isReliable)), identifier(channel, type) { reserveBySizeHint(); }
 
-		Message(const LNet2Byte type, const LNetByte channel = 0) : isReliable(true), identifier{ channel, type} {}
+		Message(const DeliveryMode deliveryMode, const LNetByte channel, const LNet2Byte type) : deliveryMode(deliveryMode), identifier(channel, type) { reserveBySizeHint(); }
 
-		Message(const bool isReliable, const LNetByte channel, const LNet2Byte type) : isReliable(isReliable), identifier(channel, type) {}
+		Message(const MessageIdentifier identifier) : deliveryMode(DeliveryMode::Reliable), identifier(identifier) { reserveBySizeHint(); }
 
-		Message(const MessageIdentifier identifier) : isReliable(true), identifier(identifier) {}
+		Message(const bool isReliable, const MessageIdentifier identifier) : deliveryMode(toDeliveryMode(isReliable)), identifier(identifier) { reserveBySizeHint(); }
 
-		Message(const bool isReliable, const MessageIdentifier identifier) : isReliable(isReliable), identifier(identifier) {}
+		Message(const DeliveryMode deliveryMode, const MessageIdentifier identifier) : deliveryMode(deliveryMode), identifier(identifier) { reserveBySizeHint(); }
 
 		Message(const LNetByte* arr, const size_t& length);
 
 		Message(const LNetByte* arr, const size_t& length, const LNetByte& channel);
 
+		// Borrow the payload of a received packet instead of copying it, the message (and its copies) own the packet from now on
+		Message(ENetPacket* packet, const LNetByte& channel);
+
 
 		// GETTERS AND SETTERS
 		void setMsgChannel(const LNetByte value);
 		void setMsgType   (const LNet2Byte value);
 		void setMsgSize   (const LNet4Byte value);
 		void setIsReliable(const bool value);
+		void setDeliveryMode(const DeliveryMode value);
 
 		MessageIdentifier getMsgIdentifier() const;
 		LNetByte getMsgChannel() const;
 		LNet2Byte getMsgType() const;
 		LNet4Byte getMsgSize() const;
 		bool getIsReliable() const;
+		DeliveryMode getDeliveryMode() const;
+		// Sequence number a received LatestOnly message was sent with
+		LNet2Byte getSequence() const;
 		
-		const std::vector<LNetByte>& getPayload() const;
+		std::span<const LNetByte> getPayload() const;
 
 
 		// STATIC
@@ -96,6 +135,37 @@ namespace lnet
 		template<typename... Args>
 		static Message createByArgs(const bool isReliable, const LNetByte channel, const LNet2Byte type, const Args... args);
 
+		template<typename... Args>
+		static Message createByArgs(const DeliveryMode deliveryMode, const LNetByte channel, const LNet2Byte type, const Args... args);
+
+		// Reliable or Unreliable
+		static DeliveryMode toDeliveryMode(const bool isReliable);
+
+		// Whether data is big enough to be the network form of a message
+		static bool isNetworkMessage(const LNetByte* data, const size_t length);
+
+		// Put a channel escape in front of a packet's message, takes the packet and returns the new one
+		static ENetPacket* toChannelEscapedPacket(ENetPacket* packet, const LNetByte& channel);
+
+		// A new packet with a channel escape in front of the packet's message, the packet stays the caller's (nullptr when it couldn't be created)
+		static ENetPacket* channelEscapedCopy(const ENetPacket* packet, const LNetByte& channel);
+
+		// Whether data is the network form of a container of several messages
+		static bool isNetworkContainer(const LNetByte* data, const size_t length);
+
+		// The messages of a received container packet, they borrow their payloads from it and own it from now on.
+		// Unpacking stops at the first message that doesn't fit in the packet
+		static std::vector<Message> fromContainerPacket(ENetPacket* packet, const LNetByte& channel);
+
+		// The type of a LatestOnly packet made by toNetworkPacket (before any channel escape), false for other packets
+		static bool latestOnlyTypeOf(const ENetPacket* packet, LNet2Byte& type);
+
+		// Write the sequence of such a packet, senders stamp it for the peer it goes to
+		static void setLatestOnlySequence(ENetPacket* packet, const LNet2Byte& sequence);
+
+		// enet packet flags of a delivery mode
+		static enet_uint32 toPacketFlags(const DeliveryMode deliveryMode);
+
 
 		// TO BUFFERS
 
@@ -129,6 +199,9 @@ namespace lnet
 		template<typename T, size_t SIZE>
 		Message& operator <<(const std::array<T, SIZE>& arr);
 
+		// Input raw bytes (no size in front)
+		Message& writeBytes(const void* data, const size_t size);
+
 
 
 		// OUTPUTS
@@ -151,6 +224,12 @@ namespace lnet
 		template<typename T, size_t SIZE>
 		Message& operator >>(std::array<T, SIZE>& arr);
 
+		// Output raw bytes (no size in front)
+		Message& readBytes(void* data, const size_t size);
+
+		// Bytes left to output
+		size_t getReadRemaining() const;
+
 
 		// Print
 		friend std::ostream& operator<<(std::ostream& os, const Message& msg);
@@ -160,13 +239,49 @@ namespace lnet
 		// reset function
 		void reset(LNetByte channel=0, LNet2Byte type=0);
 
+	private:
+
+		// Borrow a message's network form out of a received packet (one packet can hold several messages)
+		Message(const std::shared_ptr<ENetPacket>& packet, const LNetByte* data, const size_t length, const LNetByte& channel);
+
+		// Reserve the payload capacity messages of this type usually end up with
+		void reserveBySizeHint();
+
+		// Write the network form of the message to destination (needs getMsgSize() bytes)
+		void writeNetworkBytes(LNetByte* destination) const;
+
+		// Read the header of a message's network form (channel escape, type, and the sequence of a LatestOnly message), returns its size
+		size_t readNetworkHeader(const LNetByte* data, const size_t length);
+
+		// Parse [channel escape][latest only escape][type] at the start of data, returns the header size, 0 when data is too small for it
+		static size_t parseNetworkHeader(const LNetByte* data, const size_t length, MessageIdentifier& identifier, LNet2Byte& sequence, DeliveryMode& deliveryMode);
+
+		// Read a network order type at position and move past it, false when data is too small
+		static bool readNetworkType(const LNetByte* data, const size_t length, size_t& position, LNet2Byte& type);
+
+		// Size of the network header this message is sent with
+		size_t networkHeaderSize() const;
+
+
+		// Payload bytes, whether owned or borrowed from a received packet
+		const LNetByte* payloadData() const { return packet ? borrowedPayload : payload.data(); }
+		size_t payloadSize() const { return packet ? borrowedSize : payload.size(); }
+
+		// Make sure the payload is owned before writing to it (copies a borrowed payload once)
+		void ownPayload() { if (packet) copyBorrowedPayload(); }
+		void copyBorrowedPayload();
+
 	private:
 		
 		MessageIdentifier identifier;
 		
-		bool isReliable;
+		DeliveryMode deliveryMode;
+		LNet2Byte sequence = 0;
 		
 		std::vector<LNetByte> payload;  // Payload follows after the header
+		std::shared_ptr<ENetPacket> packet; // Received packet the payload is borrowed from (null when the payload is owned)
+		const LNetByte* borrowedPayload = nullptr;
+		size_t borrowedSize = 0;
 		size_t readPosition = 0; // To track the current read position in the payload
 		MessageSizes inputSize = MessageSizes::Size4Byte;
 		MessageSizes outputSize = MessageSizes::Size4Byte;          
@@ -210,6 +325,8 @@ namespace lnet
 		static_assert(std::is_trivial<T>::value && std::is_standard_layout<T>::value,
 			"Only trivial types can be added to the payload");
 
+		ownPayload();
+
 		size_t sizeBefore = payload.size();
 		payload.resize(sizeBefore + sizeof(T));
 
@@ -285,12 +402,12 @@ namespace lnet
 			"Only trivial types can be added to the payload");
 
 		// Verify it can be taken as input
-		if (readPosition + sizeof(T) > payload.size())
+		if (readPosition + sizeof(T) > payloadSize())
 		{
 			throw std::runtime_error("Not enough data in payload to extract type.");
 		}
 
-		std::memcpy(reinterpret_cast<void*>(&value), payload.data(), sizeof(T));
+		std::memcpy(reinterpret_cast<void*>(&value), payloadData() + readPosition, sizeof(T));
 
 		readPosition += sizeof(T);
 
@@ -381,6 +498,16 @@ namespace lnet
 		return msg;
 	}
 
+	template<typename ...Args>
+	Message Message::createByArgs(const DeliveryMode deliveryMode, const LNetByte channel, const LNet2Byte type, const Args...args)
+	{
+		auto msg = Message(deliveryMode, channel, type);
+
+		(void(msg.operator<<(args)), ...);
+
+		return msg;
+	}
+
 
 }
 #endif
\ No newline at end of file
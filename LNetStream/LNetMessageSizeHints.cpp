@@ -0,0 +1,40 @@
+#include "LNetMessageSizeHints.hpp"
+
+namespace lnet
+{
+	// Initialize the static hints (all zero, nothing learned yet)
+	std::array<std::atomic<LNet2Byte>, std::numeric_limits<LNet2Byte>::max() + 1> MessageSizeHints::hints{};
+
+	// Capacity worth reserving for a new message of this type
+
+	size_t MessageSizeHints::get(const LNet2Byte type)
+	{
+		return hints[type].load(std::memory_order_relaxed);
+	}
+
+	// Learn from a finished message of this type
+
+	void MessageSizeHints::record(const LNet2Byte type, const size_t payloadSize)
+	{
+		LNet2Byte size = static_cast<LNet2Byte>(payloadSize < LNET_MAX_SIZE_HINT ? payloadSize : LNET_MAX_SIZE_HINT);
+		LNet2Byte current = hints[type].load(std::memory_order_relaxed);
+
+		// Jump up right away (a smaller hint means a reallocation), but only decay slowly,
+		// so the hint follows the biggest recent size of the type rather than the average
+		if (size >= current)
+		{
+			if (size != current)
+			{
+				hints[type].store(size, std::memory_order_relaxed);
+			}
+			return;
+		}
+
+		LNet2Byte decay = static_cast<LNet2Byte>((current - size) >> decayShift);
+
+		if (decay > 0)
+		{
+			hints[type].store(current - decay, std::memory_order_relaxed);
+		}
+	}
+}
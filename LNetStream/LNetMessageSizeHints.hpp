@@ -0,0 +1,32 @@
+#ifndef LNET_MESSAGE_SIZE_HINTS_HPP
+#define LNET_MESSAGE_SIZE_HINTS_HPP
+
+#include <array>
+#include <atomic>
+#include <limits>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// Biggest capacity a hint can ask for, so one huge message doesn't make every message of its type reserve a lot
+	constexpr size_t LNET_MAX_SIZE_HINT = std::numeric_limits<LNet2Byte>::max();
+
+	class MessageSizeHints
+	{
+	public:
+		// Capacity worth reserving for a new message of this type (0 until a message of that type was sent)
+		static size_t get(const LNet2Byte type);
+
+		// Learn from a finished message of this type (called when a message is serialized)
+		static void record(const LNet2Byte type, const size_t payloadSize);
+
+	private:
+		// How fast the hint decays towards smaller sizes (1 / 2^shift of the difference every message)
+		static constexpr int decayShift = 4;
+
+		// One running estimate per message type, relaxed atomics as a lost update only costs a reallocation
+		static std::array<std::atomic<LNet2Byte>, std::numeric_limits<LNet2Byte>::max() + 1> hints;
+	};
+}
+
+#endif
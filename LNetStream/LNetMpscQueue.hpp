@@ -0,0 +1,128 @@
+#ifndef LNET_MPSC_QUEUE_HPP
+#define LNET_MPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include "LNetSpscQueue.hpp"
+
+namespace lnet
+{
+	// Bounded lock free queue for any number of producer threads and exactly one consumer thread.
+	// Every slot carries a sequence number telling whether it is free for the producer of that round,
+	// or filled for the consumer, so producers only contend on the tail index
+	template<typename T>
+	class MpscQueue
+	{
+	public:
+		// Capacity is rounded up to a power of 2
+		explicit MpscQueue(const size_t capacity = 1024);
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+
+		// Any thread, returns false (and leaves value untouched) when the queue is full
+		bool push(T&& value);
+
+		// Consumer only, returns false when the queue is empty (or the next producer didn't finish writing)
+		bool pop(T& value);
+
+	private:
+		struct Slot
+		{
+			std::atomic<size_t> sequence;
+			T value;
+		};
+
+		std::unique_ptr<Slot[]> slots;
+		size_t mask;
+
+		// Next slot to push, shared by the producers
+		alignas(LNET_CACHE_LINE_SIZE) std::atomic<size_t> tail;
+
+		// Next slot to pop, consumer only
+		alignas(LNET_CACHE_LINE_SIZE) size_t head;
+	};
+
+
+	template<typename T>
+	MpscQueue<T>::MpscQueue(const size_t capacity) :
+		tail(0), head(0)
+	{
+		size_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		slots = std::make_unique<Slot[]>(size);
+		mask = size - 1;
+
+		// Slot i is free for the producer of position i
+		for (size_t i = 0; i < size; i++)
+		{
+			slots[i].sequence.store(i, std::memory_order_relaxed);
+		}
+	}
+
+	template<typename T>
+	bool MpscQueue<T>::push(T&& value)
+	{
+		size_t position = tail.load(std::memory_order_relaxed);
+		Slot* slot;
+
+		while (true)
+		{
+			slot = &slots[position & mask];
+			const size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+			if (difference == 0)
+			{
+				// Free for this position, claim it
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+				{
+					break;
+				}
+			}
+			else if (difference < 0)
+			{
+				// Still holds the value of the previous round, full
+				return false;
+			}
+			else
+			{
+				// Another producer took it
+				position = tail.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->value = std::move(value);
+		slot->sequence.store(position + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	template<typename T>
+	bool MpscQueue<T>::pop(T& value)
+	{
+		Slot& slot = slots[head & mask];
+
+		if (slot.sequence.load(std::memory_order_acquire) != head + 1)
+		{
+			return false;
+		}
+
+		// The moved from slot is left empty, it doesn't keep what it held alive
+		value = std::move(slot.value);
+
+		// Free it for the producer of the next round
+		slot.sequence.store(head + mask + 1, std::memory_order_release);
+		head++;
+
+		return true;
+	}
+}
+
+#endif
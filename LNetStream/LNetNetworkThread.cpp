@@ -0,0 +1,197 @@
+#include "LNetNetworkThread.hpp"
+#include <cstring>
+#include <stdexcept>
+
+namespace lnet
+{
+	NetworkThread::NetworkThread() :
+		host(nullptr),
+		serviceTimeout(LNET_DEFAULT_SERVICE_TIMEOUT),
+		running(false),
+		wakeSocket(ENET_SOCKET_NULL),
+		wakeAddress{ ENET_HOST_ANY, 0 },
+		wakePending(false)
+	{ }
+
+	void NetworkThread::start(ENetHost* host, const LNet4Byte& serviceTimeout,
+		const BeforeServiceCallback& beforeService, const EventCallback& onEvent)
+	{
+		if (running.load())
+		{
+			throw std::runtime_error("Network thread is already running.");
+		}
+
+		if (!host)
+		{
+			throw std::runtime_error("Network thread needs a host.");
+		}
+
+		this->host = host;
+		this->serviceTimeout = serviceTimeout;
+		this->beforeService = beforeService;
+		this->onEvent = onEvent;
+
+		// The host wakes up by sending itself a datagram, so find out where it listens
+		if (enet_socket_get_address(host->socket, &wakeAddress) < 0)
+		{
+			throw std::runtime_error("Couldn't get the host's address.");
+		}
+
+		if (wakeAddress.host == ENET_HOST_ANY)
+		{
+			enet_address_set_host_ip(&wakeAddress, "127.0.0.1");
+		}
+
+		ENetSocket socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+
+		if (socket == ENET_SOCKET_NULL)
+		{
+			throw std::runtime_error("Couldn't create the wake up socket.");
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(wakeMutex);
+			wakeSocket = socket;
+		}
+
+		host->intercept = NetworkThread::intercept;
+
+		wakePending.store(false);
+		running.store(true);
+
+		thread = std::thread(&NetworkThread::run, this);
+	}
+
+	void NetworkThread::stop()
+	{
+		if (!running.exchange(false))
+		{
+			return;
+		}
+
+		// wake() is a no-op from here on, wake the thread directly
+		sendWake();
+
+		thread.join();
+
+		// Send whatever was queued while the thread stopped
+		beforeService();
+		enet_host_flush(host);
+
+		host->intercept = nullptr;
+
+		std::lock_guard<std::mutex> lock(wakeMutex);
+
+		enet_socket_destroy(wakeSocket);
+		wakeSocket = ENET_SOCKET_NULL;
+	}
+
+	// Make the network thread leave enet_host_service now, cheap when a wake up is already on its way.
+	// Any thread, does nothing once the thread is stopping
+
+	void NetworkThread::wake()
+	{
+		if (!running.load())
+		{
+			return;
+		}
+
+		// Pairs with the fence in run(), either the thread sees what was queued before this call,
+		// or this call sees wakePending cleared and sends a new wake up
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (wakePending.exchange(true))
+		{
+			return;
+		}
+
+		sendWake();
+	}
+
+	bool NetworkThread::isRunning() const
+	{
+		return running.load();
+	}
+
+	NetworkThread::~NetworkThread()
+	{
+		stop();
+	}
+
+	/// <summary>
+	/// The thread's loop, send what's queued, block in enet_host_service, handle everything that's ready
+	/// </summary>
+
+	void NetworkThread::run()
+	{
+		ENetEvent event;
+
+		while (running.load())
+		{
+			// Anything queued from here on sends a new wake up
+			wakePending.store(false);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+
+			beforeService();
+
+			// Block until there is traffic, a wake up or the timeout, then take everything else that's ready
+			int result = enet_host_service(host, &event, serviceTimeout);
+
+			while (result > 0)
+			{
+				if (event.type != LNET_EVENT_TYPE_WAKE)
+				{
+					onEvent(event);
+				}
+
+				result = enet_host_service(host, &event, 0);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Catches the wake up datagram before enet parses it and turns it into a LNET_EVENT_TYPE_WAKE event
+	/// </summary>
+	/// <param name="host"></param>
+	/// <param name="event"></param>
+	/// <returns>1 if the datagram was a wake up, 0 to let enet handle it</returns>
+
+	int ENET_CALLBACK NetworkThread::intercept(ENetHost* host, ENetEvent* event)
+	{
+		if (host->receivedDataLength != sizeof(LNET_WAKE_MAGIC) ||
+			std::memcmp(host->receivedData, &LNET_WAKE_MAGIC, sizeof(LNET_WAKE_MAGIC)) != 0)
+		{
+			return 0;
+		}
+
+		// A non NONE event makes enet_host_service return right away instead of waiting out the timeout
+		if (event)
+		{
+			event->type = LNET_EVENT_TYPE_WAKE;
+			event->peer = nullptr;
+			event->packet = nullptr;
+		}
+
+		return 1;
+	}
+
+	/// <summary>
+	/// Send the wake up datagram, nothing once the wake up socket is gone
+	/// </summary>
+
+	void NetworkThread::sendWake()
+	{
+		std::lock_guard<std::mutex> lock(wakeMutex);
+
+		if (wakeSocket == ENET_SOCKET_NULL)
+		{
+			return;
+		}
+
+		ENetBuffer buffer;
+		buffer.data = const_cast<LNet4Byte*>(&LNET_WAKE_MAGIC);
+		buffer.dataLength = sizeof(LNET_WAKE_MAGIC);
+
+		enet_socket_send(wakeSocket, &wakeAddress, &buffer, 1);
+	}
+}
@@ -0,0 +1,121 @@
+#ifndef LNET_NETWORK_THREAD_HPP
+#define LNET_NETWORK_THREAD_HPP
+
+#include <enet/enet.h>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// Event type enet_host_service returns when the network thread was woken up early (not a real enet event)
+	constexpr ENetEventType LNET_EVENT_TYPE_WAKE = static_cast<ENetEventType>(0x100);
+
+	// Datagram a host sends itself to wake up, caught by the intercept callback before enet parses it
+	constexpr LNet4Byte LNET_WAKE_MAGIC = 0x4B574E4C; // "LNWK"
+
+	// Default time the network thread blocks in enet_host_service when nothing happens (milliseconds)
+	constexpr LNet4Byte LNET_DEFAULT_SERVICE_TIMEOUT = 10;
+
+	// Send commands the lock free queue holds for the thread owning the host, the ones past it wait in a locked overflow
+	constexpr size_t LNET_SEND_QUEUE_CAPACITY = 8192;
+
+	// Who a queued packet goes to
+	enum class SendTarget
+	{
+		Client,
+		Clients,
+		BroadcastExcept,
+		Broadcast,
+	};
+
+	// A packet waiting for the thread that owns the host to send it
+	struct SendCommand
+	{
+		SendTarget target = SendTarget::Client;
+
+		// The client for Client, the excluded client for BroadcastExcept
+		LNet4Byte clientID = 0;
+
+		// The clients for Clients
+		std::vector<LNet4Byte> clientIDs;
+
+		LNetByte channel = 0;
+		ENetPacket* packet = nullptr;
+	};
+
+	// Runs an ENetHost on its own thread, blocking in enet_host_service until there is traffic,
+	// the timeout passes, or another thread calls wake()
+	class NetworkThread
+	{
+	public:
+		// Called on the network thread before every enet_host_service call (send what was queued)
+		using BeforeServiceCallback = std::function<void()>;
+		// Called on the network thread for every enet event
+		using EventCallback = std::function<void(const ENetEvent&)>;
+
+		NetworkThread();
+
+		NetworkThread(const NetworkThread&) = delete;
+		NetworkThread& operator=(const NetworkThread&) = delete;
+
+		void start(ENetHost* host, const LNet4Byte& serviceTimeout,
+			const BeforeServiceCallback& beforeService, const EventCallback& onEvent);
+
+		// Stops and joins the thread, runs beforeService one last time and flushes the host
+		void stop();
+
+		// Make the network thread leave enet_host_service now, cheap when a wake up is already on its way.
+		// Any thread, does nothing once the thread is stopping
+		void wake();
+
+		bool isRunning() const;
+
+		~NetworkThread();
+
+	private:
+
+		/// <summary>
+		/// The thread's loop, send what's queued, block in enet_host_service, handle everything that's ready
+		/// </summary>
+		void run();
+
+		/// <summary>
+		/// Catches the wake up datagram before enet parses it and turns it into a LNET_EVENT_TYPE_WAKE event
+		/// </summary>
+		/// <param name="host"></param>
+		/// <param name="event"></param>
+		/// <returns>1 if the datagram was a wake up, 0 to let enet handle it</returns>
+		static int ENET_CALLBACK intercept(ENetHost* host, ENetEvent* event);
+
+		/// <summary>
+		/// Send the wake up datagram, nothing once the wake up socket is gone
+		/// </summary>
+		void sendWake();
+
+	private:
+
+		ENetHost* host;
+		LNet4Byte serviceTimeout;
+
+		BeforeServiceCallback beforeService;
+		EventCallback onEvent;
+
+		std::thread thread;
+		std::atomic<bool> running;
+
+		// Socket used to send the wake up datagram to the host's own address,
+		// guarded so stop() can't destroy it while another thread's wake() sends on it
+		std::mutex wakeMutex;
+		ENetSocket wakeSocket;
+		ENetAddress wakeAddress;
+
+		// Set while a wake up datagram is on its way, so a burst of wake() calls sends only one
+		std::atomic<bool> wakePending;
+	};
+}
+
+#endif
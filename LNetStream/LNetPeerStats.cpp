@@ -0,0 +1,31 @@
+#include "LNetPeerStats.hpp"
+
+namespace lnet
+{
+	// Empty stats for nullptr
+
+	PeerStats PeerStats::ofPeer(const ENetPeer* peer)
+	{
+		PeerStats stats;
+
+		if (!peer)
+		{
+			return stats;
+		}
+
+		stats.roundTripTime = peer->roundTripTime;
+		stats.roundTripTimeVariance = peer->roundTripTimeVariance;
+		stats.lowestRoundTripTime = peer->lowestRoundTripTime;
+
+		stats.packetLoss = static_cast<float>(peer->packetLoss) / static_cast<float>(ENET_PEER_PACKET_LOSS_SCALE);
+		stats.packetThrottle = static_cast<float>(peer->packetThrottle) / static_cast<float>(ENET_PEER_PACKET_THROTTLE_SCALE);
+
+		stats.incomingBandwidth = peer->incomingBandwidth;
+		stats.outgoingBandwidth = peer->outgoingBandwidth;
+
+		stats.reliableDataInTransit = peer->reliableDataInTransit;
+		stats.waitingData = peer->totalWaitingData;
+
+		return stats;
+	}
+}
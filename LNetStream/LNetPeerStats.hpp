@@ -0,0 +1,40 @@
+#ifndef LNET_PEER_STATS_HPP
+#define LNET_PEER_STATS_HPP
+
+#include <enet/enet.h>
+#include <cstddef>
+#include "LNetTypes.hpp"
+
+namespace lnet
+{
+	// How often the thread owning the host copies the stats for the other threads to read, milliseconds
+	constexpr LNet4Byte LNET_STATS_PUBLISH_INTERVAL = 10;
+
+	// What enet measured about a connection
+	struct PeerStats
+	{
+		// Mean round trip time of reliable packets and its mean deviation, milliseconds
+		LNet4Byte roundTripTime = 0;
+		LNet4Byte roundTripTimeVariance = 0;
+		LNet4Byte lowestRoundTripTime = 0;
+
+		// Mean loss of reliable packets, 0 to 1
+		float packetLoss = 0;
+
+		// Share of unreliable packets enet lets through, 0 to 1 (lowered when the round trip time rises)
+		float packetThrottle = 1;
+
+		// Bytes a second the peer announced it can receive and send, 0 is unlimited
+		LNet4Byte incomingBandwidth = 0;
+		LNet4Byte outgoingBandwidth = 0;
+
+		// Reliable bytes sent and not acknowledged yet, and bytes of received packets waiting to be delivered
+		LNet4Byte reliableDataInTransit = 0;
+		size_t waitingData = 0;
+
+		// Empty stats for nullptr
+		static PeerStats ofPeer(const ENetPeer* peer);
+	};
+}
+
+#endif
@@ -0,0 +1,201 @@
+#include "LNetPriorityScheduler.hpp"
+#include <algorithm>
+
+namespace lnet
+{
+	PriorityScheduler::PriorityScheduler(Server& server, const size_t bytesPerTick) :
+		server(server),
+		disconnectCallback(server.addDisconnectCallback([this](const LNet4Byte& clientID) { removeClient(clientID); })),
+		bytesPerTick(bytesPerTick)
+	{
+	}
+
+	// Budget of clients without their own
+
+	void PriorityScheduler::setByteBudget(const size_t value)
+	{
+		bytesPerTick = value;
+	}
+
+	void PriorityScheduler::setClientByteBudget(const LNet4Byte& clientID, const size_t value)
+	{
+		clients[clientID].bytesPerTick = value;
+	}
+
+	// Update of an entity for a client, the message is shared by every client it is queued for
+
+	void PriorityScheduler::queue(const LNet4Byte& clientID, const LNet4Byte& entityID, const Message& message, const float weight)
+	{
+		queueShared(clientID, entityID, std::make_shared<const Message>(message), weight);
+	}
+
+	void PriorityScheduler::queue(const std::vector<LNet4Byte>& clientIDs, const LNet4Byte& entityID, const Message& message, const float weight)
+	{
+		auto shared = std::make_shared<const Message>(message);
+
+		for (const LNet4Byte& clientID : clientIDs)
+		{
+			queueShared(clientID, entityID, shared, weight);
+		}
+	}
+
+	// Grow the priorities and send what fits every client's budget
+
+	void PriorityScheduler::tick()
+	{
+		for (auto client = clients.begin(); client != clients.end();)
+		{
+			tickClient(client->first, client->second);
+
+			// Nothing left to keep, a queue for a stale ID doesn't outlive its updates
+			if (client->second.updates.empty() && client->second.bytesPerTick == 0)
+			{
+				client = clients.erase(client);
+			}
+			else
+			{
+				++client;
+			}
+		}
+	}
+
+	// Drop a client's updates and budget (done by the server's disconnects)
+
+	void PriorityScheduler::removeClient(const LNet4Byte& clientID)
+	{
+		clients.erase(clientID);
+	}
+
+	PriorityScheduler::~PriorityScheduler()
+	{
+		server.removeDisconnectCallback(disconnectCallback);
+	}
+
+	// Drop the pending updates of an entity for every client
+
+	void PriorityScheduler::removeEntity(const LNet4Byte& entityID)
+	{
+		for (auto& [clientID, client] : clients)
+		{
+			auto index = client.indexOfEntity.find(entityID);
+
+			if (index != client.indexOfEntity.end())
+			{
+				eraseUpdate(client, index->second);
+			}
+		}
+	}
+
+	size_t PriorityScheduler::getPendingCount(const LNet4Byte& clientID) const
+	{
+		auto client = clients.find(clientID);
+
+		return client != clients.end() ? client->second.updates.size() : 0;
+	}
+
+	/// <summary>
+	/// Queue or replace an entity's update for a client
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <param name="entityID"></param>
+	/// <param name="message"></param>
+	/// <param name="weight"></param>
+
+	void PriorityScheduler::queueShared(const LNet4Byte& clientID, const LNet4Byte& entityID, const std::shared_ptr<const Message>& message, const float weight)
+	{
+		ClientQueue& client = clients[clientID];
+
+		auto [index, isNew] = client.indexOfEntity.try_emplace(entityID, client.updates.size());
+
+		if (isNew)
+		{
+			client.updates.push_back({ entityID, message, weight, 0 });
+		}
+		else
+		{
+			// Keeps the priority it gathered so far
+			Update& update = client.updates[index->second];
+
+			update.message = message;
+			update.weight = weight;
+		}
+	}
+
+	/// <summary>
+	/// Send the client's highest priority updates that fit its budget
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <param name="client"></param>
+
+	void PriorityScheduler::tickClient(const LNet4Byte& clientID, ClientQueue& client)
+	{
+		if (client.updates.empty())
+		{
+			return;
+		}
+
+		order.resize(client.updates.size());
+		isSent.assign(client.updates.size(), false);
+
+		for (size_t index = 0; index < client.updates.size(); index++)
+		{
+			client.updates[index].priority += client.updates[index].weight;
+			order[index] = index;
+		}
+
+		std::sort(order.begin(), order.end(),
+			[&client](const size_t& a, const size_t& b) { return client.updates[a].priority > client.updates[b].priority; });
+
+		const size_t budget = client.bytesPerTick ? client.bytesPerTick : bytesPerTick;
+		size_t remaining = budget;
+
+		for (const size_t& index : order)
+		{
+			size_t size = client.updates[index].message->getMsgSize();
+
+			// An update bigger than the whole budget goes out alone instead of starving forever
+			if (size > remaining && !(remaining == budget && size > budget))
+			{
+				continue;
+			}
+
+			server.sendClient(clientID, *client.updates[index].message);
+
+			isSent[index] = true;
+			remaining -= std::min(size, remaining);
+
+			if (remaining == 0)
+			{
+				break;
+			}
+		}
+
+		// From the back so swapped in updates were already looked at
+		for (size_t index = client.updates.size(); index-- > 0;)
+		{
+			if (isSent[index])
+			{
+				eraseUpdate(client, index);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Remove an update by swapping the last one in its place
+	/// </summary>
+	/// <param name="client"></param>
+	/// <param name="index"></param>
+
+	void PriorityScheduler::eraseUpdate(ClientQueue& client, const size_t index)
+	{
+		client.indexOfEntity.erase(client.updates[index].entityID);
+
+		if (index != client.updates.size() - 1)
+		{
+			client.updates[index] = std::move(client.updates.back());
+			client.indexOfEntity[client.updates[index].entityID] = index;
+		}
+
+		client.updates.pop_back();
+	}
+}
@@ -0,0 +1,107 @@
+#ifndef LNET_PRIORITY_SCHEDULER_HPP
+#define LNET_PRIORITY_SCHEDULER_HPP
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	// Bytes a client is sent per scheduler tick by default (20 kB/s at 10 ticks a second)
+	constexpr size_t LNET_DEFAULT_CLIENT_BYTE_BUDGET = 2000;
+
+	// Holds entity updates per client instead of queueing them to enet right away.
+	// Every tick each pending update's priority grows by its weight (distance, importance...) and the highest priority
+	// updates that fit the client's byte budget are sent, the rest keep growing until they go out.
+	// A newer update of an entity replaces the pending one and keeps its priority. Use it from one thread
+	class PriorityScheduler
+	{
+	public:
+		PriorityScheduler(Server& server, const size_t bytesPerTick = LNET_DEFAULT_CLIENT_BYTE_BUDGET);
+
+		PriorityScheduler(const PriorityScheduler&) = delete;
+		PriorityScheduler& operator=(const PriorityScheduler&) = delete;
+
+		// Budget of clients without their own
+		void setByteBudget(const size_t bytesPerTick);
+		void setClientByteBudget(const LNet4Byte& clientID, const size_t bytesPerTick);
+
+		// Update of an entity for a client, the message is shared by every client it is queued for
+		void queue(const LNet4Byte& clientID, const LNet4Byte& entityID, const Message& message, const float weight = 1.0f);
+		void queue(const std::vector<LNet4Byte>& clientIDs, const LNet4Byte& entityID, const Message& message, const float weight = 1.0f);
+
+		// Grow the priorities and send what fits every client's budget
+		void tick();
+
+		// Drop a client's updates and budget (done by the server's disconnects)
+		void removeClient(const LNet4Byte& clientID);
+
+		// Drop the pending updates of an entity for every client
+		void removeEntity(const LNet4Byte& entityID);
+
+		size_t getPendingCount(const LNet4Byte& clientID) const;
+
+		~PriorityScheduler();
+
+	private:
+
+		struct Update
+		{
+			LNet4Byte entityID = 0;
+			std::shared_ptr<const Message> message;
+
+			float weight = 0;
+			float priority = 0;
+		};
+
+		struct ClientQueue
+		{
+			// 0 uses the scheduler's budget
+			size_t bytesPerTick = 0;
+
+			std::vector<Update> updates;
+			std::unordered_map<LNet4Byte, size_t> indexOfEntity;
+		};
+
+		/// <summary>
+		/// Queue or replace an entity's update for a client
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <param name="entityID"></param>
+		/// <param name="message"></param>
+		/// <param name="weight"></param>
+		void queueShared(const LNet4Byte& clientID, const LNet4Byte& entityID, const std::shared_ptr<const Message>& message, const float weight);
+
+		/// <summary>
+		/// Send the client's highest priority updates that fit its budget
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <param name="client"></param>
+		void tickClient(const LNet4Byte& clientID, ClientQueue& client);
+
+		/// <summary>
+		/// Remove an update by swapping the last one in its place
+		/// </summary>
+		/// <param name="client"></param>
+		/// <param name="index"></param>
+		static void eraseUpdate(ClientQueue& client, const size_t index);
+
+	private:
+
+		Server& server;
+
+		// Calls removeClient for every client that disconnects
+		LNet4Byte disconnectCallback;
+
+		size_t bytesPerTick;
+
+		std::unordered_map<LNet4Byte, ClientQueue> clients;
+
+		// Kept between ticks to avoid allocating
+		std::vector<size_t> order;
+		std::vector<LNetByte> isSent;
+	};
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include "LNetRateController.hpp"
+#include <algorithm>
+
+namespace lnet
+{
+	RateController::RateController(Server& server, const LNet4Byte& tickRate, const std::array<RateTier, LNET_RATE_TIER_COUNT>& tiers) :
+		server(server),
+		disconnectCallback(server.addDisconnectCallback([this](const LNet4Byte& clientID) { removeClient(clientID); })),
+		tickRate(std::max<LNet4Byte>(tickRate, 1)),
+		tiers(tiers),
+		upgradeDelay(LNET_DEFAULT_RATE_UPGRADE_TICKS),
+		tickCount(0)
+	{
+	}
+
+	void RateController::setUpgradeDelay(const LNet4Byte& ticks)
+	{
+		upgradeDelay = ticks;
+	}
+
+	// Once every server tick, before the sends: looks at every added client's link again
+
+	void RateController::tick()
+	{
+		tickCount++;
+
+		for (auto& [clientID, client] : clients)
+		{
+			evaluate(clientID, client);
+		}
+	}
+
+	// Should the client be sent an update on this tick
+
+	bool RateController::isDue(const LNet4Byte& clientID) const
+	{
+		// Spread by ID so the clients of a tier don't all go out on the same tick
+		return (tickCount + clientID) % intervalOf(tierOf(clientID)) == 0;
+	}
+
+	// The clients due on this tick
+
+	std::vector<LNet4Byte> RateController::filterDue(const std::vector<LNet4Byte>& clientIDs) const
+	{
+		std::vector<LNet4Byte> due;
+		due.reserve(clientIDs.size());
+
+		for (const LNet4Byte& clientID : clientIDs)
+		{
+			if (isDue(clientID))
+			{
+				due.push_back(clientID);
+			}
+		}
+
+		return due;
+	}
+
+	// Tier index of the client, 0 is the highest rate and the most detail
+
+	size_t RateController::getDetailLevel(const LNet4Byte& clientID) const
+	{
+		return tierOf(clientID);
+	}
+
+	LNet4Byte RateController::getRate(const LNet4Byte& clientID) const
+	{
+		return std::min(tiers[tierOf(clientID)].rate, tickRate);
+	}
+
+	// A client starts being rated in the first tier (the server's disconnects remove it)
+
+	void RateController::addClient(const LNet4Byte& clientID)
+	{
+		clients.try_emplace(clientID);
+	}
+
+	void RateController::removeClient(const LNet4Byte& clientID)
+	{
+		clients.erase(clientID);
+	}
+
+	RateController::~RateController()
+	{
+		server.removeDisconnectCallback(disconnectCallback);
+	}
+
+	/// <summary>
+	/// Is the link within the tier's limits (scaled down by hysteresis)
+	/// </summary>
+	/// <param name="stats"></param>
+	/// <param name="tier"></param>
+	/// <param name="hysteresis"></param>
+	/// <returns></returns>
+
+	bool RateController::fits(const PeerStats& stats, const RateTier& tier, const float hysteresis)
+	{
+		return stats.roundTripTime <= tier.maxRoundTripTime * hysteresis
+			&& stats.packetLoss <= tier.maxPacketLoss * hysteresis
+			&& stats.packetThrottle >= tier.minPacketThrottle;
+	}
+
+	/// <summary>
+	/// Move the client down or up a tier from its link
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <param name="client"></param>
+
+	void RateController::evaluate(const LNet4Byte& clientID, ClientRate& client)
+	{
+		PeerStats stats = server.getClientStats(clientID);
+
+		if (client.tier + 1 < tiers.size() && !fits(stats, tiers[client.tier], 1.0f))
+		{
+			client.tier++;
+			client.upgradeTicks = 0;
+			return;
+		}
+
+		if (client.tier > 0 && fits(stats, tiers[client.tier - 1], LNET_RATE_HYSTERESIS))
+		{
+			if (++client.upgradeTicks >= upgradeDelay)
+			{
+				client.tier--;
+				client.upgradeTicks = 0;
+			}
+		}
+		else
+		{
+			client.upgradeTicks = 0;
+		}
+	}
+
+	/// <summary>
+	/// Ticks between two sends at the tier's rate
+	/// </summary>
+	/// <param name="tier"></param>
+	/// <returns></returns>
+
+	LNet4Byte RateController::intervalOf(const size_t tier) const
+	{
+		LNet4Byte rate = std::max<LNet4Byte>(tiers[tier].rate, 1);
+
+		return std::max<LNet4Byte>((tickRate + rate / 2) / rate, 1);
+	}
+
+	/// <summary>
+	/// Tier of the client, the first one when it wasn't added
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <returns></returns>
+
+	size_t RateController::tierOf(const LNet4Byte& clientID) const
+	{
+		auto client = clients.find(clientID);
+
+		return client != clients.end() ? client->second.tier : 0;
+	}
+}
@@ -0,0 +1,125 @@
+#ifndef LNET_RATE_CONTROLLER_HPP
+#define LNET_RATE_CONTROLLER_HPP
+
+#include <array>
+#include <unordered_map>
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	// A send rate and the link it needs, a client gets the first tier whose limits it is within
+	struct RateTier
+	{
+		LNet4Byte rate = 0;              // Hz
+		LNet4Byte maxRoundTripTime = 0;  // milliseconds
+		float maxPacketLoss = 0;         // 0 to 1
+		float minPacketThrottle = 0;     // 0 to 1
+	};
+
+	constexpr size_t LNET_RATE_TIER_COUNT = 4;
+
+	constexpr std::array<RateTier, LNET_RATE_TIER_COUNT> LNET_DEFAULT_RATE_TIERS = { {
+		{ 60, 100, 0.02f, 0.75f },
+		{ 30, 200, 0.05f, 0.5f },
+		{ 20, 300, 0.10f, 0.25f },
+		{ 10, 0xFFFFFFFF, 1.0f, 0.0f },
+	} };
+
+	// A client moves up a tier only once it has been within the higher tier's limits scaled by this
+	// for the upgrade delay, it moves down as soon as it leaves its own tier's limits
+	constexpr float LNET_RATE_HYSTERESIS = 0.75f;
+	constexpr LNet4Byte LNET_DEFAULT_RATE_UPGRADE_TICKS = 120;
+
+	// Picks a send rate per client from what enet measured about its connection (round trip time, loss, throttle),
+	// from the tiers' rates (60/30/20/10 Hz by default) down to a tick rate the server ticks at. Clients on a worse
+	// link get fewer, bigger steps instead of a growing queue, tiers past the first can also send less detail.
+	// Clients due on a tick are spread over the ticks by their ID. Only added clients are rated, the others are treated
+	// as the first tier. Use it from the thread calling the server's tick()
+	class RateController
+	{
+	public:
+		RateController(Server& server, const LNet4Byte& tickRate = 60,
+			const std::array<RateTier, LNET_RATE_TIER_COUNT>& tiers = LNET_DEFAULT_RATE_TIERS);
+
+		RateController(const RateController&) = delete;
+		RateController& operator=(const RateController&) = delete;
+
+		void setUpgradeDelay(const LNet4Byte& ticks);
+
+		// Once every server tick, before the sends: looks at every added client's link again
+		void tick();
+
+		// Should the client be sent an update on this tick
+		bool isDue(const LNet4Byte& clientID) const;
+
+		// The clients due on this tick
+		std::vector<LNet4Byte> filterDue(const std::vector<LNet4Byte>& clientIDs) const;
+
+		// Tier index of the client, 0 is the highest rate and the most detail
+		size_t getDetailLevel(const LNet4Byte& clientID) const;
+		LNet4Byte getRate(const LNet4Byte& clientID) const;
+
+		// A client starts being rated in the first tier (the server's disconnects remove it)
+		void addClient(const LNet4Byte& clientID);
+		void removeClient(const LNet4Byte& clientID);
+
+		~RateController();
+
+	private:
+
+		struct ClientRate
+		{
+			size_t tier = 0;
+
+			// Consecutive ticks the link was good enough for the tier above
+			LNet4Byte upgradeTicks = 0;
+		};
+
+		/// <summary>
+		/// Is the link within the tier's limits (scaled down by hysteresis)
+		/// </summary>
+		/// <param name="stats"></param>
+		/// <param name="tier"></param>
+		/// <param name="hysteresis"></param>
+		/// <returns></returns>
+		static bool fits(const PeerStats& stats, const RateTier& tier, const float hysteresis);
+
+		/// <summary>
+		/// Move the client down or up a tier from its link
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <param name="client"></param>
+		void evaluate(const LNet4Byte& clientID, ClientRate& client);
+
+		/// <summary>
+		/// Ticks between two sends at the tier's rate
+		/// </summary>
+		/// <param name="tier"></param>
+		/// <returns></returns>
+		LNet4Byte intervalOf(const size_t tier) const;
+
+		/// <summary>
+		/// Tier of the client, the first one when it wasn't added
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <returns></returns>
+		size_t tierOf(const LNet4Byte& clientID) const;
+
+	private:
+
+		Server& server;
+
+		// Calls removeClient for every client that disconnects
+		LNet4Byte disconnectCallback;
+
+		LNet4Byte tickRate;
+		std::array<RateTier, LNET_RATE_TIER_COUNT> tiers;
+
+		LNet4Byte upgradeDelay;
+		LNet4Byte tickCount;
+
+		std::unordered_map<LNet4Byte, ClientRate> clients;
+	};
+}
+
+#endif
@@ -0,0 +1,177 @@
+#include "LNetReplicatedEntity.hpp"
+
+namespace lnet
+{
+	ReplicatedEntity::ReplicatedEntity(const LNet2Byte& kind) :
+		kind(kind),
+		dirtyMask(0)
+	{
+	}
+
+	LNet2Byte ReplicatedEntity::getKind() const
+	{
+		return kind;
+	}
+
+	size_t ReplicatedEntity::getFieldCount() const
+	{
+		return fields.size();
+	}
+
+	LNetFieldMask ReplicatedEntity::getDirtyMask() const
+	{
+		return dirtyMask;
+	}
+
+	LNetFieldMask ReplicatedEntity::getAllFieldsMask() const
+	{
+		return fields.size() == LNET_MAX_REPLICATED_FIELDS ? ~LNetFieldMask(0) : (LNetFieldMask(1) << fields.size()) - 1;
+	}
+
+	void ReplicatedEntity::markDirty(const LNetFieldMask& mask)
+	{
+		dirtyMask |= mask & getAllFieldsMask();
+	}
+
+	void ReplicatedEntity::clearDirty()
+	{
+		dirtyMask = 0;
+	}
+
+	// [mask][the fields of the mask]
+
+	void ReplicatedEntity::writeFields(Message& message, const LNetFieldMask& mask) const
+	{
+		message << mask;
+
+		for (size_t field = 0; field < fields.size(); field++)
+		{
+			if (mask & (LNetFieldMask(1) << field))
+			{
+				message.writeBytes(values.data() + fields[field].offset, fields[field].size);
+			}
+		}
+	}
+
+	// Bytes writeFields writes for the mask (mask included), 0 when the entity doesn't have every field of the mask
+
+	size_t ReplicatedEntity::getFieldsSize(const LNetFieldMask& mask) const
+	{
+		if (mask & ~getAllFieldsMask())
+		{
+			return 0;
+		}
+
+		size_t size = sizeof(LNetFieldMask);
+
+		for (size_t field = 0; field < fields.size(); field++)
+		{
+			if (mask & (LNetFieldMask(1) << field))
+			{
+				size += fields[field].size;
+			}
+		}
+
+		return size;
+	}
+
+	// Read what writeFields wrote, returns the mask of the fields read.
+	// Throws when the mask or the message doesn't fit the entity, before changing any field
+
+	LNetFieldMask ReplicatedEntity::readFields(Message& message)
+	{
+		LNetFieldMask mask;
+		message >> mask;
+
+		readMaskedFields(message, mask);
+
+		return mask;
+	}
+
+	// Read the fields of the mask, what writeFields wrote after it (throws as readFields does)
+
+	void ReplicatedEntity::readMaskedFields(Message& message, const LNetFieldMask& mask)
+	{
+		const size_t size = getFieldsSize(mask);
+
+		if (size == 0)
+		{
+			throw std::runtime_error("Replicated entity has no such field.");
+		}
+
+		// All or nothing, a cut message leaves the entity as it was
+		if (size - sizeof(LNetFieldMask) > message.getReadRemaining())
+		{
+			throw std::runtime_error("Not enough data in payload to extract the replicated fields.");
+		}
+
+		for (size_t field = 0; field < fields.size(); field++)
+		{
+			if (mask & (LNetFieldMask(1) << field))
+			{
+				message.readBytes(values.data() + fields[field].offset, fields[field].size);
+			}
+		}
+	}
+
+	/// <summary>
+	/// Add a field of size bytes, returns its index
+	/// </summary>
+	/// <param name="data"></param>
+	/// <param name="size"></param>
+	/// <returns></returns>
+
+	LNetByte ReplicatedEntity::addFieldBytes(const void* data, const size_t size)
+	{
+		if (fields.size() == LNET_MAX_REPLICATED_FIELDS)
+		{
+			throw std::runtime_error("Too many replicated fields.");
+		}
+
+		// Update entries carry their size in 2 bytes
+		if (sizeof(LNetFieldMask) + values.size() + size > LNET_MAX_REPLICATED_ENTITY_SIZE)
+		{
+			throw std::runtime_error("Replicated entity is too big.");
+		}
+
+		fields.push_back({ values.size(), size });
+		values.insert(values.end(), static_cast<const LNetByte*>(data), static_cast<const LNetByte*>(data) + size);
+
+		return static_cast<LNetByte>(fields.size() - 1);
+	}
+
+	/// <summary>
+	/// Set a field, marks it dirty when the bytes changed
+	/// </summary>
+	/// <param name="field"></param>
+	/// <param name="data"></param>
+	/// <param name="size"></param>
+
+	void ReplicatedEntity::setFieldBytes(const LNetByte& field, const void* data, const size_t size)
+	{
+		LNetByte* bytes = const_cast<LNetByte*>(fieldBytes(field, size));
+
+		if (std::memcmp(bytes, data, size) != 0)
+		{
+			std::memcpy(bytes, data, size);
+			dirtyMask |= LNetFieldMask(1) << field;
+		}
+	}
+
+	/// <summary>
+	/// The field's bytes, throws when the field or its size is wrong
+	/// </summary>
+	/// <param name="field"></param>
+	/// <param name="size"></param>
+	/// <returns></returns>
+
+	const LNetByte* ReplicatedEntity::fieldBytes(const LNetByte& field, const size_t size) const
+	{
+		if (field >= fields.size() || fields[field].size != size)
+		{
+			throw std::runtime_error("Replicated field doesn't exist or has another type.");
+		}
+
+		return values.data() + fields[field].offset;
+	}
+}
@@ -0,0 +1,137 @@
+#ifndef LNET_REPLICATED_ENTITY_HPP
+#define LNET_REPLICATED_ENTITY_HPP
+
+#include <type_traits>
+#include <vector>
+#include "LNetMessage.hpp"
+
+namespace lnet
+{
+	// Message types of the replication layer (ReplicationServer, ReplicationClient)
+	// [entity ID][kind][field mask][fields]
+	constexpr LNet2Byte LNET_TYPE_REPLICATION_SPAWN = 0xFFF7;
+	// [entity ID]
+	constexpr LNet2Byte LNET_TYPE_REPLICATION_DESPAWN = 0xFFF6;
+	// ([entity ID][size][field mask][fields])...
+	constexpr LNet2Byte LNET_TYPE_REPLICATION_UPDATE = 0xFFF5;
+
+	// A bit per field
+	using LNetFieldMask = LNet4Byte;
+	constexpr size_t LNET_MAX_REPLICATED_FIELDS = sizeof(LNetFieldMask) * 8;
+
+	// Biggest entity once written (mask and every field), the size in front of an update entry is 2 bytes
+	constexpr size_t LNET_MAX_REPLICATED_ENTITY_SIZE = 0xFFFF;
+
+	// Entity whose fields are replicated to the clients. Fields are trivially copyable values added in the same order
+	// on the server and the client (an entity of a kind is built the same way on both), setting a field to a new value
+	// marks it dirty so only what changed is serialized
+	class ReplicatedEntity
+	{
+	public:
+		ReplicatedEntity(const LNet2Byte& kind = 0);
+
+		// Add a field, returns its index (throws past LNET_MAX_REPLICATED_FIELDS or LNET_MAX_REPLICATED_ENTITY_SIZE)
+		template<typename T>
+		LNetByte addField(const T& initial = T());
+
+		// Marks the field dirty when the value changed
+		template<typename T>
+		void set(const LNetByte& field, const T& value);
+
+		template<typename T>
+		T get(const LNetByte& field) const;
+
+		LNet2Byte getKind() const;
+		size_t getFieldCount() const;
+
+		LNetFieldMask getDirtyMask() const;
+		LNetFieldMask getAllFieldsMask() const;
+		void markDirty(const LNetFieldMask& mask);
+		void clearDirty();
+
+		// [mask][the fields of the mask]
+		void writeFields(Message& message, const LNetFieldMask& mask) const;
+
+		// Bytes writeFields writes for the mask (mask included), 0 when the entity doesn't have every field of the mask
+		size_t getFieldsSize(const LNetFieldMask& mask) const;
+
+		// Read what writeFields wrote, returns the mask of the fields read.
+		// Throws when the mask or the message doesn't fit the entity, before changing any field
+		LNetFieldMask readFields(Message& message);
+
+		// Read the fields of the mask, what writeFields wrote after it (throws as readFields does)
+		void readMaskedFields(Message& message, const LNetFieldMask& mask);
+
+	private:
+
+		struct Field
+		{
+			size_t offset = 0;
+			size_t size = 0;
+		};
+
+		/// <summary>
+		/// Add a field of size bytes, returns its index
+		/// </summary>
+		/// <param name="data"></param>
+		/// <param name="size"></param>
+		/// <returns></returns>
+		LNetByte addFieldBytes(const void* data, const size_t size);
+
+		/// <summary>
+		/// Set a field, marks it dirty when the bytes changed
+		/// </summary>
+		/// <param name="field"></param>
+		/// <param name="data"></param>
+		/// <param name="size"></param>
+		void setFieldBytes(const LNetByte& field, const void* data, const size_t size);
+
+		/// <summary>
+		/// The field's bytes, throws when the field or its size is wrong
+		/// </summary>
+		/// <param name="field"></param>
+		/// <param name="size"></param>
+		/// <returns></returns>
+		const LNetByte* fieldBytes(const LNetByte& field, const size_t size) const;
+
+	private:
+
+		LNet2Byte kind;
+
+		std::vector<Field> fields;
+		std::vector<LNetByte> values;
+
+		LNetFieldMask dirtyMask;
+	};
+
+	// template field functions
+
+	template<typename T>
+	LNetByte ReplicatedEntity::addField(const T& initial)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Replicated fields must be trivially copyable.");
+
+		return addFieldBytes(&initial, sizeof(T));
+	}
+
+	template<typename T>
+	void ReplicatedEntity::set(const LNetByte& field, const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Replicated fields must be trivially copyable.");
+
+		setFieldBytes(field, &value, sizeof(T));
+	}
+
+	template<typename T>
+	T ReplicatedEntity::get(const LNetByte& field) const
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Replicated fields must be trivially copyable.");
+
+		T value;
+		std::memcpy(&value, fieldBytes(field, sizeof(T)), sizeof(T));
+
+		return value;
+	}
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include "LNetReplicationClient.hpp"
+
+namespace lnet
+{
+	ReplicationClient::ReplicationClient(Client& client, const LNetByte& reliableChannel, const LNetByte& unreliableChannel) :
+		client(client),
+		reliableChannel(reliableChannel),
+		unreliableChannel(unreliableChannel)
+	{
+		client.setMessageCallback({ reliableChannel, LNET_TYPE_REPLICATION_SPAWN },
+			[this](Message& message) { handleSpawn(message); });
+		client.setMessageCallback({ reliableChannel, LNET_TYPE_REPLICATION_DESPAWN },
+			[this](Message& message) { handleDespawn(message); });
+		client.setMessageCallback({ unreliableChannel, LNET_TYPE_REPLICATION_UPDATE },
+			[this](Message& message) { handleUpdate(message); });
+	}
+
+	void ReplicationClient::registerKind(const LNet2Byte& kind, const LNetEntityFactory& factory)
+	{
+		factories[kind] = factory;
+	}
+
+	void ReplicationClient::setOnSpawn(const LNetSpawnCallback& func)
+	{
+		onSpawn = func;
+	}
+
+	void ReplicationClient::setOnUpdate(const LNetUpdateCallback& func)
+	{
+		onUpdate = func;
+	}
+
+	void ReplicationClient::setOnDespawn(const LNetDespawnCallback& func)
+	{
+		onDespawn = func;
+	}
+
+	// nullptr when there is no such entity
+
+	ReplicatedEntity* ReplicationClient::find(const LNet4Byte& entityID)
+	{
+		auto entity = entities.find(entityID);
+
+		return entity != entities.end() ? &entity->second : nullptr;
+	}
+
+	// Forget every entity (after a reconnect)
+
+	void ReplicationClient::clear()
+	{
+		entities.clear();
+	}
+
+	ReplicationClient::~ReplicationClient()
+	{
+		client.removeMessageCallback({ reliableChannel, LNET_TYPE_REPLICATION_SPAWN });
+		client.removeMessageCallback({ reliableChannel, LNET_TYPE_REPLICATION_DESPAWN });
+		client.removeMessageCallback({ unreliableChannel, LNET_TYPE_REPLICATION_UPDATE });
+	}
+
+	/// <summary>
+	/// Build the entity from its kind's factory and read its fields
+	/// </summary>
+	/// <param name="message"></param>
+
+	void ReplicationClient::handleSpawn(Message& message)
+	{
+		LNet4Byte entityID;
+		ReplicatedEntity entity;
+
+		try
+		{
+			LNet2Byte kind;
+			message >> entityID >> kind;
+
+			// No factory for the kind, nothing can be built from it
+			auto factory = factories.find(kind);
+			if (factory == factories.end())
+			{
+				return;
+			}
+
+			entity = factory->second();
+			entity.readFields(message);
+			entity.clearDirty();
+		}
+		catch (const std::runtime_error&)
+		{
+			// Malformed, drop it
+			return;
+		}
+
+		ReplicatedEntity& spawned = entities.insert_or_assign(entityID, std::move(entity)).first->second;
+
+		if (onSpawn)
+		{
+			onSpawn(entityID, spawned);
+		}
+	}
+
+	/// <summary>
+	/// Remove the entity
+	/// </summary>
+	/// <param name="message"></param>
+
+	void ReplicationClient::handleDespawn(Message& message)
+	{
+		// Malformed, drop it
+		if (message.getReadRemaining() < sizeof(LNet4Byte))
+		{
+			return;
+		}
+
+		LNet4Byte entityID;
+		message >> entityID;
+
+		if (entities.erase(entityID) && onDespawn)
+		{
+			onDespawn(entityID);
+		}
+	}
+
+	/// <summary>
+	/// Apply every entity update of the packed update, skips the entries that don't fit their entity and drops the rest
+	/// of a malformed message
+	/// </summary>
+	/// <param name="message"></param>
+
+	void ReplicationClient::handleUpdate(Message& message)
+	{
+		while (message.getReadRemaining() > 0)
+		{
+			if (message.getReadRemaining() < sizeof(LNet4Byte) + sizeof(LNet2Byte) + sizeof(LNetFieldMask))
+			{
+				return;
+			}
+
+			LNet4Byte entityID;
+			LNet2Byte size;
+			message >> entityID >> size;
+
+			// Entries are never cut by the server, the message is broken
+			if (size < sizeof(LNetFieldMask) || size > message.getReadRemaining())
+			{
+				return;
+			}
+
+			LNetFieldMask changedFields;
+			message >> changedFields;
+
+			auto entity = entities.find(entityID);
+
+			// Not spawned yet (the update overtook the spawn), already despawned,
+			// or respawned as another kind since the update was written
+			if (entity == entities.end() || entity->second.getFieldsSize(changedFields) != size)
+			{
+				skipped.resize(size - sizeof(LNetFieldMask));
+				message.readBytes(skipped.data(), skipped.size());
+				continue;
+			}
+
+			entity->second.readMaskedFields(message, changedFields);
+			entity->second.clearDirty();
+
+			if (onUpdate)
+			{
+				onUpdate(entityID, entity->second, changedFields);
+			}
+		}
+	}
+}
@@ -0,0 +1,80 @@
+#ifndef LNET_REPLICATION_CLIENT_HPP
+#define LNET_REPLICATION_CLIENT_HPP
+
+#include <unordered_map>
+#include "LNetClient.hpp"
+#include "LNetReplicatedEntity.hpp"
+
+namespace lnet
+{
+	// Mirrors the entities of a ReplicationServer. Every kind the server spawns needs a factory building the entity
+	// with the same fields as on the server, spawns of other kinds are dropped. Malformed messages are dropped too, nothing
+	// the server sends throws out of the client's tick(). The callbacks are called by the client's tick()
+	class ReplicationClient
+	{
+	public:
+		using LNetEntityFactory = std::function<ReplicatedEntity()>;
+		using LNetSpawnCallback = std::function<void(const LNet4Byte& entityID, ReplicatedEntity& entity)>;
+		using LNetUpdateCallback = std::function<void(const LNet4Byte& entityID, ReplicatedEntity& entity, const LNetFieldMask& changedFields)>;
+		using LNetDespawnCallback = std::function<void(const LNet4Byte& entityID)>;
+
+		ReplicationClient(Client& client, const LNetByte& reliableChannel = 0, const LNetByte& unreliableChannel = 1);
+
+		ReplicationClient(const ReplicationClient&) = delete;
+		ReplicationClient& operator=(const ReplicationClient&) = delete;
+
+		void registerKind(const LNet2Byte& kind, const LNetEntityFactory& factory);
+
+		void setOnSpawn(const LNetSpawnCallback& func);
+		void setOnUpdate(const LNetUpdateCallback& func);
+		void setOnDespawn(const LNetDespawnCallback& func);
+
+		// nullptr when there is no such entity
+		ReplicatedEntity* find(const LNet4Byte& entityID);
+
+		// Forget every entity (after a reconnect)
+		void clear();
+
+		~ReplicationClient();
+
+	private:
+
+		/// <summary>
+		/// Build the entity from its kind's factory and read its fields
+		/// </summary>
+		/// <param name="message"></param>
+		void handleSpawn(Message& message);
+
+		/// <summary>
+		/// Remove the entity
+		/// </summary>
+		/// <param name="message"></param>
+		void handleDespawn(Message& message);
+
+		/// <summary>
+		/// Apply every entity update of the packed update, skips the entries that don't fit their entity and drops the rest
+		/// of a malformed message
+		/// </summary>
+		/// <param name="message"></param>
+		void handleUpdate(Message& message);
+
+	private:
+
+		Client& client;
+
+		LNetByte reliableChannel;
+		LNetByte unreliableChannel;
+
+		std::unordered_map<LNet2Byte, LNetEntityFactory> factories;
+		std::unordered_map<LNet4Byte, ReplicatedEntity> entities;
+
+		LNetSpawnCallback onSpawn;
+		LNetUpdateCallback onUpdate;
+		LNetDespawnCallback onDespawn;
+
+		// Skipped bytes of unknown entities
+		std::vector<LNetByte> skipped;
+	};
+}
+
+#endif
@@ -0,0 +1,160 @@
+#include "LNetReplicationServer.hpp"
+#include <algorithm>
+
+namespace lnet
+{
+	ReplicationServer::ReplicationServer(Server& server, const LNetByte& reliableChannel, const LNetByte& unreliableChannel) :
+		server(server),
+		disconnectCallback(server.addDisconnectCallback([this](const LNet4Byte& clientID) { removeClient(clientID); })),
+		reliableChannel(reliableChannel),
+		unreliableChannel(unreliableChannel),
+		refreshInterval(LNET_DEFAULT_REPLICATION_REFRESH_TICKS)
+	{
+	}
+
+	// Spawns the entity on every client, the returned entity stays valid until it's despawned
+
+	ReplicatedEntity& ReplicationServer::spawn(const LNet4Byte& entityID, ReplicatedEntity&& entity)
+	{
+		auto [entry, isNew] = entities.insert_or_assign(entityID, Entry{ std::move(entity), 0 });
+
+		// The spawn carries every field
+		entry->second.entity.clearDirty();
+
+		if (!clientIDs.empty())
+		{
+			server.sendClients(clientIDs, spawnMessage(entityID, entry->second.entity));
+		}
+
+		return entry->second.entity;
+	}
+
+	void ReplicationServer::despawn(const LNet4Byte& entityID)
+	{
+		if (entities.erase(entityID) && !clientIDs.empty())
+		{
+			server.sendClients(clientIDs, Message::createByArgs(true, reliableChannel, LNET_TYPE_REPLICATION_DESPAWN, entityID));
+		}
+	}
+
+	// nullptr when there is no such entity
+
+	ReplicatedEntity* ReplicationServer::find(const LNet4Byte& entityID)
+	{
+		auto entry = entities.find(entityID);
+
+		return entry != entities.end() ? &entry->second.entity : nullptr;
+	}
+
+	// A client starts receiving the entities, every existing one is spawned on it (the server's disconnects remove it)
+
+	void ReplicationServer::addClient(const LNet4Byte& clientID)
+	{
+		if (std::find(clientIDs.begin(), clientIDs.end(), clientID) != clientIDs.end())
+		{
+			return;
+		}
+
+		clientIDs.push_back(clientID);
+
+		for (const auto& [entityID, entry] : entities)
+		{
+			server.sendClient(clientID, spawnMessage(entityID, entry.entity));
+		}
+	}
+
+	void ReplicationServer::removeClient(const LNet4Byte& clientID)
+	{
+		clientIDs.erase(std::remove(clientIDs.begin(), clientIDs.end(), clientID), clientIDs.end());
+	}
+
+	ReplicationServer::~ReplicationServer()
+	{
+		server.removeDisconnectCallback(disconnectCallback);
+	}
+
+	// 0 never resends whole entities
+
+	void ReplicationServer::setRefreshInterval(const LNet4Byte& ticks)
+	{
+		refreshInterval = ticks;
+	}
+
+	// Send the dirty fields
+
+	void ReplicationServer::tick()
+	{
+		Message update(DeliveryMode::Unreliable, unreliableChannel, LNET_TYPE_REPLICATION_UPDATE);
+
+		for (auto& [entityID, entry] : entities)
+		{
+			if (refreshInterval && ++entry.ticksSinceRefresh >= refreshInterval)
+			{
+				entry.entity.markDirty(entry.entity.getAllFieldsMask());
+			}
+
+			LNetFieldMask mask = entry.entity.getDirtyMask();
+			if (!mask)
+			{
+				continue;
+			}
+
+			if (mask == entry.entity.getAllFieldsMask())
+			{
+				entry.ticksSinceRefresh = 0;
+			}
+
+			// The size lets clients skip entities they don't know (an update overtaking its spawn)
+			Message fields;
+			entry.entity.writeFields(fields, mask);
+			entry.entity.clearDirty();
+
+			std::span<const LNetByte> payload = fields.getPayload();
+
+			if (update.getMsgSize() + sizeof(LNet4Byte) + sizeof(LNet2Byte) + payload.size() > LNET_MAX_REPLICATION_UPDATE_SIZE
+				&& update.getPayload().size())
+			{
+				sendUpdate(update);
+				update = Message(DeliveryMode::Unreliable, unreliableChannel, LNET_TYPE_REPLICATION_UPDATE);
+			}
+
+			update << entityID << static_cast<LNet2Byte>(payload.size());
+			update.writeBytes(payload.data(), payload.size());
+		}
+
+		if (update.getPayload().size())
+		{
+			sendUpdate(update);
+		}
+	}
+
+	/// <summary>
+	/// Spawn message of an entity, carries every field
+	/// </summary>
+	/// <param name="entityID"></param>
+	/// <param name="entity"></param>
+	/// <returns></returns>
+
+	Message ReplicationServer::spawnMessage(const LNet4Byte& entityID, const ReplicatedEntity& entity) const
+	{
+		Message message(DeliveryMode::Reliable, reliableChannel, LNET_TYPE_REPLICATION_SPAWN);
+
+		message << entityID << entity.getKind();
+		entity.writeFields(message, entity.getAllFieldsMask());
+
+		return message;
+	}
+
+	/// <summary>
+	/// Send a packed update to every client
+	/// </summary>
+	/// <param name="message"></param>
+
+	void ReplicationServer::sendUpdate(const Message& message)
+	{
+		if (!clientIDs.empty())
+		{
+			server.sendClients(clientIDs, message);
+		}
+	}
+}
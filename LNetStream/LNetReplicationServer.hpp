@@ -0,0 +1,85 @@
+#ifndef LNET_REPLICATION_SERVER_HPP
+#define LNET_REPLICATION_SERVER_HPP
+
+#include <unordered_map>
+#include "LNetReplicatedEntity.hpp"
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	// Packed updates are split past this size so they stay in one datagram
+	constexpr size_t LNET_MAX_REPLICATION_UPDATE_SIZE = 1200;
+
+	// Ticks between two full resends of an entity, updates are unreliable so a lost one is repaired by the next resend
+	constexpr LNet4Byte LNET_DEFAULT_REPLICATION_REFRESH_TICKS = 60;
+
+	// Replicates entities to the added clients: spawns and despawns are reliable on one channel, tick() packs the dirty
+	// fields of every entity into unreliable updates on another, shared by every client.
+	// Use it from the thread calling the server's tick()
+	class ReplicationServer
+	{
+	public:
+		ReplicationServer(Server& server, const LNetByte& reliableChannel = 0, const LNetByte& unreliableChannel = 1);
+
+		ReplicationServer(const ReplicationServer&) = delete;
+		ReplicationServer& operator=(const ReplicationServer&) = delete;
+
+		// Spawns the entity on every client, the returned entity stays valid until it's despawned
+		ReplicatedEntity& spawn(const LNet4Byte& entityID, ReplicatedEntity&& entity);
+		void despawn(const LNet4Byte& entityID);
+
+		// nullptr when there is no such entity
+		ReplicatedEntity* find(const LNet4Byte& entityID);
+
+		// A client starts receiving the entities, every existing one is spawned on it (the server's disconnects remove it)
+		void addClient(const LNet4Byte& clientID);
+		void removeClient(const LNet4Byte& clientID);
+
+		// 0 never resends whole entities
+		void setRefreshInterval(const LNet4Byte& ticks);
+
+		// Send the dirty fields
+		void tick();
+
+		~ReplicationServer();
+
+	private:
+
+		struct Entry
+		{
+			ReplicatedEntity entity;
+			LNet4Byte ticksSinceRefresh = 0;
+		};
+
+		/// <summary>
+		/// Spawn message of an entity, carries every field
+		/// </summary>
+		/// <param name="entityID"></param>
+		/// <param name="entity"></param>
+		/// <returns></returns>
+		Message spawnMessage(const LNet4Byte& entityID, const ReplicatedEntity& entity) const;
+
+		/// <summary>
+		/// Send a packed update to every client
+		/// </summary>
+		/// <param name="message"></param>
+		void sendUpdate(const Message& message);
+
+	private:
+
+		Server& server;
+
+		// Calls removeClient for every client that disconnects
+		LNet4Byte disconnectCallback;
+
+		LNetByte reliableChannel;
+		LNetByte unreliableChannel;
+
+		LNet4Byte refreshInterval;
+
+		std::unordered_map<LNet4Byte, Entry> entities;
+		std::vector<LNet4Byte> clientIDs;
+	};
+}
+
+#endif
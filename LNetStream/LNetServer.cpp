@@ -1,10 +1,10 @@
 #include "LNetServer.hpp"
+#include <algorithm>
 
 namespace lnet
 {
 	Server::Server(const LNet4Byte& maxConnections, const LNetByte& channels) :
 		settings(maxConnections, channels),
-		currentClientID(0),
 		host(nullptr)
 	{
 		if (enet_initialize() != 0)
@@ -18,61 +18,95 @@ namespace lnet
 		settings.address.host = ENET_HOST_ANY;
 		settings.address.port = port;
 
-		
-		// clear queue
-		possibleIDs = std::queue<LNet4Byte>();
-		clients.clear();
-
 
 		// create host
-		host = enet_host_create(&settings.address, settings.maxConnections, settings.channels, 0, 0);
+		host = enet_host_create(&settings.address, settings.maxConnections, settings.physicalChannels, 0, 0);
 
 		if (!host)
 		{
 			throw std::runtime_error("Couldn't create server.");
 		}
+
+		// one client slot per peer slot
+		clients.reset(host->peerCount);
+
+		compression.install(host, settings.compression);
+		host->checksum = settings.checksum ? Checksum::enetCallback : nullptr;
 	}
 	void Server::tick()
 	{
+		tick(TickBudget());
+	}
+	void Server::tick(const TickBudget& budget)
+	{
+		const auto start = std::chrono::steady_clock::now();
+
+		// Take what the network thread received
+		ReceivedMessage received;
+		while (receivedMessages.pop(received))
+		{
+			deferMessage(std::move(received));
+		}
+
+		// The network thread services the host
+		if (useNetworkThread)
+		{
+			dispatchDeferred(budget, start);
+
+			// No callback runs between ticks, free the callback pages replaced since the last one
+			messageCallbacks.reclaim();
+			return;
+		}
+
+		// This thread owns the host, send what other threads queued first
+		tickThread.store(std::this_thread::get_id());
+		executeQueuedSends();
+
+		// Always service the host fully, only the callbacks are budgeted
 		ENetEvent event;
 		while (enet_host_service(host, &event, 0) > 0)
 		{
-			switch (event.type)
-			{
-				case ENET_EVENT_TYPE_CONNECT:
-				{
-					// std::cout << "Server-connection\n";
-					handleConnect(event);
-					break;
-				}
-				case ENET_EVENT_TYPE_DISCONNECT:
-				{
-					// std::cout << "Server-disconnection\n";
-					handleDisconnect(event);
-					break;
-				}
-				case ENET_EVENT_TYPE_RECEIVE:
-				{
-					// std::cout << "Server-receive\n";
-					handleReceive(event);
-					enet_packet_destroy(event.packet);
-					break;
-				}
-				default:
-				{
-					std::cout << "Unknown event in the server.\n" <<
-						"Peer DATA: " << event.peer->data <<
-						"Type: " << event.type <<
-						"Channel" << event.channelID <<
-						"packet" << event.packet;
-				}
-			}
+			handleEvent(event);
 		}
+
+		publishStats();
+
+		dispatchDeferred(budget, start);
+		messageCallbacks.reclaim();
+
+		// What the callbacks sent
+		aggregator.flush();
+
+		if (!tickThreadOwnsHost.load())
+		{
+			tickThread.store(std::thread::id());
+		}
+	}
+	void Server::setPriorityChannel(const LNetByte& channel, const bool isPriority)
+	{
+		priorityChannels[channel] = isPriority;
+	}
+	size_t Server::getDeferredMessageCount() const
+	{
+		return priorityMessages.size() + deferredMessages.size();
+	}
+	void Server::setMaxDeferredMessages(const size_t count)
+	{
+		maxDeferredMessages = count;
+	}
+	size_t Server::getDroppedMessageCount() const
+	{
+		return droppedMessages;
 	}
 	void Server::terminate()
 	{
+		stopNetworkThread();
+
 		if (host)
 		{
+			// Send what other threads queued since the last tick
+			executeQueuedSends();
+
 			for (ENetPeer* peer = host->peers; peer < &host->peers[host->peerCount]; ++peer)
 			{
 				if (peer->state == ENET_PEER_STATE_CONNECTED)
@@ -83,59 +117,197 @@ namespace lnet
 			}
 			enet_host_flush(host);
 
+			// Before the host, and its peers, are gone
+			clients.clear();
+
 			enet_host_destroy(host);
 
 			host = nullptr;
 		}
 
-		clients.clear();
-		possibleIDs = std::queue<LNet4Byte>();
+		// Their clients are gone
+		priorityMessages.clear();
+		deferredMessages.clear();
+
+		{
+			std::lock_guard<std::mutex> lock(statsMutex);
+			publishedStats.clear();
+		}
 
 		enet_deinitialize();
 	}
 
+	// NETWORK THREAD
+
+	void Server::startNetworkThread(const LNet4Byte& serviceTimeout)
+	{
+		if (!host)
+		{
+			throw std::runtime_error("Server must listen before starting the network thread.");
+		}
+
+		useNetworkThread = true;
+
+		networkThread.start(host, serviceTimeout,
+			[this]() { beforeService(); },
+			[this](const ENetEvent& event) { handleEvent(event); });
+	}
+	void Server::stopNetworkThread()
+	{
+		networkThread.stop();
+
+		useNetworkThread = false;
+
+		// Whatever didn't fit the queue can be called by the next tick()
+		while (!receivedOverflow.empty() && receivedMessages.push(std::move(receivedOverflow.front())))
+		{
+			receivedOverflow.pop_front();
+		}
+	}
+
+	void Server::setCompression(const CompressionSettings& compression)
+	{
+		settings.compression = compression;
+
+		if (host && !useNetworkThread)
+		{
+			this->compression.install(host, settings.compression);
+		}
+	}
+
+	CompressionStats Server::getCompressionStats() const
+	{
+		return compression.getStats();
+	}
+
+	void Server::setPhysicalChannels(const LNetByte& count)
+	{
+		settings.physicalChannels = std::clamp<LNetByte>(count, 1, settings.channels);
+	}
+
+	MemoryFootprint Server::getMemoryFootprint() const
+	{
+		return MemoryFootprint::ofHost(host);
+	}
+
+	MemoryFootprint Server::getClientMemoryFootprint(const LNet4Byte& clientID) const
+	{
+		return MemoryFootprint::ofPeer(clients.find(clientID));
+	}
+
+	PeerStats Server::getClientStats(const LNet4Byte& clientID) const
+	{
+		const size_t slot = ClientTable::slotOf(clientID);
+
+		std::lock_guard<std::mutex> lock(statsMutex);
+		if (slot >= publishedStats.size() || !publishedStats[slot].isConnected || publishedStats[slot].clientID != clientID)
+		{
+			return {};
+		}
+
+		return publishedStats[slot].stats;
+	}
+
+	ENetHost* Server::getHost() const
+	{
+		return host;
+	}
+
+	void Server::setOnSendQueued(const std::function<void()>& func)
+	{
+		onSendQueued = func;
+	}
+
+	void Server::setTickThreadOwnsHost(const bool owns)
+	{
+		tickThreadOwnsHost.store(owns);
+
+		if (!owns)
+		{
+			tickThread.store(std::thread::id());
+		}
+	}
+
+	void Server::setChecksum(const bool enabled)
+	{
+		settings.checksum = enabled;
+
+		if (host && !useNetworkThread)
+		{
+			host->checksum = settings.checksum ? Checksum::enetCallback : nullptr;
+		}
+	}
+
+	void Server::setAggregation(const size_t maxContainerSize)
+	{
+		aggregator.setMaxContainerSize(maxContainerSize);
+	}
+
 	// MESSAGE CALLBACKS
 	
 	void Server::setMessageCallback(const MessageIdentifier& identifier, const LNetReadCallback& func)
 	{
-		messageCallbacks[identifier] = func;
+		messageCallbacks.set(identifier, func);
 	}
 	void Server::removeMessageCallback(const MessageIdentifier& identifier)
 	{
-		messageCallbacks.erase(identifier);
+		messageCallbacks.remove(identifier);
 	}
 	
 
+	void Server::setConnectValidator(const LNetConnectValidator& func)
+	{
+		connectValidator = func;
+	}
+
+	// Called with the ID of every client that disconnected, by tick() after the client's last message, so per client
+	// state kept next to the server can be dropped (thread calling tick()). Returns the handle to remove it with
+
+	LNet4Byte Server::addDisconnectCallback(const LNetDisconnectCallback& func)
+	{
+		disconnectCallbacks.emplace_back(nextDisconnectCallbackHandle, func);
+
+		return nextDisconnectCallbackHandle++;
+	}
+	void Server::removeDisconnectCallback(const LNet4Byte& handle)
+	{
+		std::erase_if(disconnectCallbacks, [&handle](const auto& entry) { return entry.first == handle; });
+	}
+
+	LNet4Byte Server::getClientToken(const LNet4Byte& clientID) const
+	{
+		ENetPeer* peer = clients.find(clientID);
+
+		return peer ? clients.tokenAt(peer->incomingPeerID) : 0;
+	}
+
 	// SEND FUNCTIONS
 	
 	void Server::sendClient(const LNet4Byte& clientID, const Message& message)
 	{
-		ENetPacket* packet = message.toNetworkPacket();
+		queueSend({ SendTarget::Client, clientID, {}, message.getMsgChannel(), message.toNetworkPacket() });
+	}
 
-		enet_peer_send(clients[clientID],
-			message.getMsgChannel(),
-			packet);
+	// A packet holding a message's network form (Message::toNetworkPacket), the server owns it from now on
+
+	void Server::sendClientPacket(const LNet4Byte& clientID, const LNetByte& channel, ENetPacket* packet)
+	{
+		queueSend({ SendTarget::Client, clientID, {}, channel, packet });
 	}
-	
+
+	void Server::sendClients(const std::vector<LNet4Byte>& clientIDs, const Message& message)
+	{
+		queueSend({ SendTarget::Clients, 0, clientIDs, message.getMsgChannel(), message.toNetworkPacket() });
+	}
+
 	void Server::sendBroadcastExcept(const LNet4Byte& clientID, const Message& message)
 	{
-		for (auto& client : clients)
-		{
-			if (client.first != clientID)
-			{
-				ENetPacket* packet = message.toNetworkPacket();
-				enet_peer_send(client.second,
-					message.getMsgChannel(),
-					packet);
-			}
-		}
+		queueSend({ SendTarget::BroadcastExcept, clientID, {}, message.getMsgChannel(), message.toNetworkPacket() });
 	}
 	
 	void Server::sendBroadcast(const Message& message)
 	{
-		ENetPacket* packet = message.toNetworkPacket();
-
-		enet_host_broadcast(host, message.getMsgChannel(), packet);
+		queueSend({ SendTarget::Broadcast, 0, {}, message.getMsgChannel(), message.toNetworkPacket() });
 	}
 	
 
@@ -144,6 +316,45 @@ namespace lnet
 		terminate();
 	}
 
+	/// <summary>
+	/// Handle any enet event (connect, disconnect, receive)
+	/// </summary>
+	/// <param name="event"></param>
+
+	void Server::handleEvent(const ENetEvent& event)
+	{
+		switch (event.type)
+		{
+			case ENET_EVENT_TYPE_CONNECT:
+			{
+				// std::cout << "Server-connection\n";
+				handleConnect(event);
+				break;
+			}
+			case ENET_EVENT_TYPE_DISCONNECT:
+			{
+				// std::cout << "Server-disconnection\n";
+				handleDisconnect(event);
+				break;
+			}
+			case ENET_EVENT_TYPE_RECEIVE:
+			{
+				// std::cout << "Server-receive\n";
+				// the message takes the packet, it is destroyed with the last copy of the message
+				handleReceive(event);
+				break;
+			}
+			default:
+			{
+				std::cout << "Unknown event in the server.\n" <<
+					"Peer DATA: " << event.peer->data <<
+					"Type: " << event.type <<
+					"Channel" << event.channelID <<
+					"packet" << event.packet;
+			}
+		}
+	}
+
 	/// <summary>
 	/// Handle the connection and saves it in the clients object
 	/// </summary>
@@ -151,11 +362,15 @@ namespace lnet
 
 	void Server::handleConnect(const ENetEvent& event)
 	{
-		LNet4Byte id = newClientID();
-
-		clients[id] = event.peer;
+		// The token came in the connect data, no round trip needed to check it
+		if (connectValidator && !connectValidator(event.data, event.peer->address))
+		{
+			// No disconnect event follows, the peer never was a client
+			enet_peer_disconnect_now(event.peer, LNET_DISCONNECT_REJECTED);
+			return;
+		}
 
-		event.peer->data = reinterpret_cast<void*>(id);
+		clients.add(event.peer, event.data);
 	}
 
 	/// <summary>
@@ -165,10 +380,19 @@ namespace lnet
 
 	void Server::handleDisconnect(const ENetEvent& event)
 	{
-		LNet4Byte clientID = reinterpret_cast<LNet4Byte>(event.peer->data);
+		aggregator.discard(event.peer);
+
+		if (!clients.isConnected(event.peer->incomingPeerID))
+		{
+			return;
+		}
+
+		ReceivedMessage received;
+		received.clientID = clients.remove(event.peer);
+		received.disconnected = true;
 
-		possibleIDs.push(clientID);
-		clients.erase(clientID);
+		// Behind its messages, so no callback sees the client after the disconnect callbacks did
+		queueReceived(std::move(received));
 	}
 
 	/// <summary>
@@ -178,27 +402,552 @@ namespace lnet
 
 	void Server::handleReceive(const ENetEvent& event)
 	{
-		Message message(event.packet->data, event.packet->dataLength, event.channelID);
+		// Too small to even hold a header, drop it
+		if (!Message::isNetworkMessage(event.packet->data, event.packet->dataLength))
+		{
+			enet_packet_destroy(event.packet);
+			return;
+		}
 
+		// Several messages sent together
+		if (Message::isNetworkContainer(event.packet->data, event.packet->dataLength))
+		{
+			for (Message& message : Message::fromContainerPacket(event.packet, event.channelID))
+			{
+				receiveMessage(event.peer, message);
+			}
+			return;
+		}
+
+		Message message(event.packet, event.channelID);
+		receiveMessage(event.peer, message);
+	}
+
+	/// <summary>
+	/// Drop a stale LatestOnly message, keep the others for the callbacks of tick()
+	/// </summary>
+	/// <param name="peer"></param>
+	/// <param name="message"></param>
+
+	void Server::receiveMessage(const ENetPeer* peer, Message& message)
+	{
+		// Older than a message of its kind that was already handled
+		if (message.getDeliveryMode() == DeliveryMode::LatestOnly && !clients.latestOnlyFilterAt(peer->incomingPeerID).accept(message))
+		{
+			return;
+		}
+
+		queueReceived({ clients.idOf(peer), std::move(message) });
+	}
+
+	/// <summary>
+	/// Hand a received message to tick(), directly or through the network thread's queue
+	/// </summary>
+	/// <param name="received"></param>
+
+	void Server::queueReceived(ReceivedMessage&& received)
+	{
+		if (!useNetworkThread)
+		{
+			deferMessage(std::move(received));
+			return;
+		}
+
+		// Keep the order if earlier messages are still waiting for room
+		if (!receivedOverflow.empty() || !receivedMessages.push(std::move(received)))
+		{
+			receivedOverflow.push_back(std::move(received));
+		}
+	}
+
+	/// <summary>
+	/// Call the disconnect callbacks for a client (thread calling tick())
+	/// </summary>
+	/// <param name="clientID"></param>
+
+	void Server::dispatchDisconnect(const LNet4Byte& clientID)
+	{
+		// A callback may remove itself or add others
+		const auto callbacks = disconnectCallbacks;
+
+		for (const auto& entry : callbacks)
+		{
+			entry.second(clientID);
+		}
+	}
+
+	/// <summary>
+	/// Call the message's callback if it has one
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <param name="message"></param>
+
+	void Server::dispatchMessage(const LNet4Byte& clientID, Message& message)
+	{
 		// Call message callback if exists
-		auto it = messageCallbacks.find(message.getMsgIdentifier());
-		if (it != messageCallbacks.end())
+		const LNetReadCallback* callback = messageCallbacks.find(message.getMsgIdentifier());
+		if (callback)
+		{
+			(*callback)(clientID, message);
+		}
+	}
+
+	/// <summary>
+	/// Keep a received message for the callbacks of this tick or the next ones (thread calling tick())
+	/// </summary>
+	/// <param name="received"></param>
+
+	void Server::deferMessage(ReceivedMessage&& received)
+	{
+		// Callbacks fall behind for good, don't let what waits for them grow without limit (disconnects are never dropped)
+		if (!received.disconnected && getDeferredMessageCount() >= maxDeferredMessages)
+		{
+			droppedMessages++;
+			return;
+		}
+
+		if (!received.disconnected && priorityChannels[received.message.getMsgChannel()])
+		{
+			priorityMessages.push_back(std::move(received));
+		}
+		else
 		{
-			it->second((LNetByte)event.peer->data, message);
+			deferredMessages.push_back(std::move(received));
 		}
 	}
 
-	const LNet4Byte Server::newClientID()
+	/// <summary>
+	/// Call the callbacks of deferred messages until the budget runs out, priority channels first
+	/// </summary>
+	/// <param name="budget"></param>
+	/// <param name="start"></param>
+
+	void Server::dispatchDeferred(const TickBudget& budget, const std::chrono::steady_clock::time_point& start)
+	{
+		size_t handled = 0;
+
+		// The first one whatever the budget, servicing alone may have used it up
+		while (handled == 0 || !budget.isExhausted(handled, start))
+		{
+			std::deque<ReceivedMessage>& queue = priorityMessages.empty() ? deferredMessages : priorityMessages;
+
+			if (queue.empty())
+			{
+				return;
+			}
+
+			ReceivedMessage received = std::move(queue.front());
+			queue.pop_front();
+
+			if (received.disconnected)
+			{
+				dispatchDisconnect(received.clientID);
+			}
+			else
+			{
+				dispatchMessage(received.clientID, received.message);
+			}
+			handled++;
+		}
+	}
+
+	/// <summary>
+	/// Send the packet now when called by the thread owning the host, otherwise queue it for that thread (any thread)
+	/// </summary>
+	/// <param name="command"></param>
+
+	void Server::queueSend(SendCommand&& command)
+	{
+		const bool threaded = useNetworkThread.load();
+
+		// The thread calling tick() owns the host when there is no network thread
+		if (!threaded && std::this_thread::get_id() == tickThread.load())
+		{
+			executeSend(command);
+
+			if (onSendQueued)
+			{
+				onSendQueued();
+			}
+			return;
+		}
+
+		// Once one send overflowed the later ones follow it, so a sender's sends keep their order
+		if (hasSendOverflow.load() || !sendCommands.push(std::move(command)))
+		{
+			std::lock_guard<std::mutex> lock(sendOverflowMutex);
+			sendOverflow.push_back(std::move(command));
+			hasSendOverflow.store(true);
+		}
+
+		if (threaded)
+		{
+			networkThread.wake();
+		}
+		else if (onSendQueued)
+		{
+			onSendQueued();
+		}
+	}
+
+	/// <summary>
+	/// Queue the command's packet on its peers, on the thread that owns the host
+	/// </summary>
+	/// <param name="command"></param>
+
+	void Server::executeSend(SendCommand& command)
+	{
+		stampLatestOnly(command);
+
+		if (command.target == SendTarget::Client)
+		{
+			ENetPeer* peer = clients.find(command.clientID);
+			if (!peer)
+			{
+				enet_packet_destroy(command.packet);
+				command.packet = nullptr;
+				return;
+			}
+
+			// Channels the peer didn't get ride on the ones it did, with the real channel in front of the message
+			if (command.channel >= peer->channelCount)
+			{
+				command.packet = Message::toChannelEscapedPacket(command.packet, command.channel);
+				command.channel %= peer->channelCount;
+			}
+
+			// Only single client sends are packed, one shared packet beats a copy in every recipient's container
+			if (aggregator.accepts(command.packet))
+			{
+				aggregateSend(command);
+				return;
+			}
+		}
+
+		// Sent on its own, what was packed before it has to leave first to keep the order
+		aggregator.flush();
+
+		switch (command.target)
+		{
+			case SendTarget::Client:
+			{
+				if (enet_peer_send(clients.find(command.clientID), command.channel, command.packet) < 0)
+				{
+					enet_packet_destroy(command.packet);
+				}
+				break;
+			}
+			case SendTarget::Clients:
+			{
+				sendPacketClients(command.clientIDs, command.channel, command.packet);
+				break;
+			}
+			case SendTarget::BroadcastExcept:
+			{
+				sendPacketBroadcast(&command.clientID, command.channel, command.packet);
+				break;
+			}
+			case SendTarget::Broadcast:
+			{
+				sendPacketBroadcast(nullptr, command.channel, command.packet);
+				break;
+			}
+		}
+
+		command.packet = nullptr;
+	}
+
+	/// <summary>
+	/// Stamp a LatestOnly packet with the sequence of its peers, a peer too far behind the shared sequence is sent its own copy
+	/// </summary>
+	/// <param name="command"></param>
+
+	void Server::stampLatestOnly(SendCommand& command)
 	{
-		if (!possibleIDs.empty())
+		LNet2Byte type;
+		if (!Message::latestOnlyTypeOf(command.packet, type))
 		{
-			LNet4Byte reusedID = possibleIDs.front();
+			return;
+		}
 
-			possibleIDs.pop();
+		MessageIdentifier identifier(command.channel, type);
 
-			return reusedID;
+		if (command.target == SendTarget::Client)
+		{
+			ENetPeer* peer = clients.find(command.clientID);
+			if (peer)
+			{
+				LatestOnlySequencer& sequencer = clients.latestOnlySequencerAt(peer->incomingPeerID);
+				LNet2Byte sequence = sequencer.peek(identifier);
+
+				Message::setLatestOnlySequence(command.packet, sequence);
+				sequencer.take(identifier, sequence);
+			}
+			return;
 		}
 
-		return currentClientID++;
+		// By ID, so peers that get their own copy can be taken out
+		if (command.target != SendTarget::Clients)
+		{
+			command.clientIDs.clear();
+
+			for (size_t slot = 0; slot < clients.slotCount(); slot++)
+			{
+				if (clients.isConnected(slot) &&
+					(command.target == SendTarget::Broadcast || clients.idAt(slot) != command.clientID))
+				{
+					command.clientIDs.push_back(clients.idAt(slot));
+				}
+			}
+
+			command.target = SendTarget::Clients;
+		}
+
+		// The newest of the peers' sequences, every peer sees its sequence move forward
+		LNet2Byte shared = 0;
+		bool hasPeer = false;
+
+		for (const LNet4Byte& clientID : command.clientIDs)
+		{
+			ENetPeer* peer = clients.find(clientID);
+			if (!peer)
+			{
+				continue;
+			}
+
+			LNet2Byte sequence = clients.latestOnlySequencerAt(peer->incomingPeerID).peek(identifier);
+			if (!hasPeer || LatestOnlySequencer::isNewer(sequence, shared))
+			{
+				shared = sequence;
+				hasPeer = true;
+			}
+		}
+
+		Message::setLatestOnlySequence(command.packet, shared);
+
+		size_t kept = 0;
+		for (size_t index = 0; index < command.clientIDs.size(); index++)
+		{
+			const LNet4Byte clientID = command.clientIDs[index];
+
+			ENetPeer* peer = clients.find(clientID);
+			if (!peer)
+			{
+				continue;
+			}
+
+			LatestOnlySequencer& sequencer = clients.latestOnlySequencerAt(peer->incomingPeerID);
+
+			// Its filter could take the shared sequence for an old one
+			if (static_cast<LNet2Byte>(shared - sequencer.peek(identifier)) >= LNET_LATEST_ONLY_MAX_JUMP)
+			{
+				ENetPacket* copy = enet_packet_create(command.packet->data, command.packet->dataLength, command.packet->flags);
+				if (copy)
+				{
+					SendCommand own{ SendTarget::Client, clientID, {}, command.channel, copy };
+					executeSend(own);
+				}
+				continue;
+			}
+
+			sequencer.take(identifier, shared);
+			command.clientIDs[kept++] = clientID;
+		}
+
+		command.clientIDs.resize(kept);
+	}
+
+	/// <summary>
+	/// Copy the command's small packet into its client's container, then destroy it
+	/// </summary>
+	/// <param name="command"></param>
+
+	void Server::aggregateSend(SendCommand& command)
+	{
+		ENetPeer* peer = clients.find(command.clientID);
+		if (peer)
+		{
+			aggregator.add(peer, command.channel, command.packet);
+		}
+
+		enet_packet_destroy(command.packet);
+		command.packet = nullptr;
+	}
+
+	/// <summary>
+	/// Network thread, runs before every enet_host_service (sends what was queued, retries received messages that didn't fit)
+	/// </summary>
+
+	void Server::beforeService()
+	{
+		while (!receivedOverflow.empty() && receivedMessages.push(std::move(receivedOverflow.front())))
+		{
+			receivedOverflow.pop_front();
+		}
+
+		executeQueuedSends();
+
+		if (std::chrono::steady_clock::now() - lastStatsPublish >= std::chrono::milliseconds(LNET_STATS_PUBLISH_INTERVAL))
+		{
+			publishStats();
+		}
+	}
+
+	/// <summary>
+	/// Copy every connected client's stats for the other threads (thread owning the host)
+	/// </summary>
+
+	void Server::publishStats()
+	{
+		std::lock_guard<std::mutex> lock(statsMutex);
+
+		publishedStats.resize(clients.slotCount());
+		for (size_t slot = 0; slot < publishedStats.size(); ++slot)
+		{
+			PublishedStats& published = publishedStats[slot];
+
+			published.isConnected = clients.isConnected(slot);
+			if (published.isConnected)
+			{
+				published.clientID = clients.idAt(slot);
+				published.stats = PeerStats::ofPeer(clients.peerAt(slot));
+			}
+		}
+
+		lastStatsPublish = std::chrono::steady_clock::now();
+	}
+
+	/// <summary>
+	/// Send everything other threads queued, in one batch (thread owning the host only)
+	/// </summary>
+
+	void Server::executeQueuedSends()
+	{
+		SendCommand command;
+		while (sendCommands.pop(command))
+		{
+			executeSend(command);
+		}
+
+		if (hasSendOverflow.load())
+		{
+			std::deque<SendCommand> overflow;
+			{
+				std::lock_guard<std::mutex> lock(sendOverflowMutex);
+
+				// What made it into the queue before a send overflowed goes first
+				while (sendCommands.pop(command))
+				{
+					executeSend(command);
+				}
+
+				overflow.swap(sendOverflow);
+				hasSendOverflow.store(false);
+			}
+
+			for (SendCommand& overflowed : overflow)
+			{
+				executeSend(overflowed);
+			}
+		}
+
+		aggregator.flush();
+	}
+
+	/// <summary>
+	/// Queue one packet on every listed client (enet reference counts it), destroys it if no client took it
+	/// </summary>
+	/// <param name="clientIDs"></param>
+	/// <param name="channel"></param>
+	/// <param name="packet"></param>
+
+	void Server::sendPacketClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, ENetPacket* packet)
+	{
+		ENetPacket* escaped = nullptr;
+
+		for (const LNet4Byte& clientID : clientIDs)
+		{
+			ENetPeer* peer = clients.find(clientID);
+			if (peer)
+			{
+				sendPacketShared(peer, channel, packet, escaped);
+			}
+		}
+
+		releasePacketShared(packet, escaped);
+	}
+
+	/// <summary>
+	/// Queue one packet on every client, except the excluded one when there is one, destroys it if no client took it
+	/// </summary>
+	/// <param name="excludedClientID"></param>
+	/// <param name="channel"></param>
+	/// <param name="packet"></param>
+
+	void Server::sendPacketBroadcast(const LNet4Byte* excludedClientID, const LNetByte& channel, ENetPacket* packet)
+	{
+		ENetPacket* escaped = nullptr;
+
+		for (size_t slot = 0; slot < clients.slotCount(); slot++)
+		{
+			if (clients.isConnected(slot) && (!excludedClientID || clients.idAt(slot) != *excludedClientID))
+			{
+				sendPacketShared(clients.peerAt(slot), channel, packet, escaped);
+			}
+		}
+
+		releasePacketShared(packet, escaped);
+	}
+
+	/// <summary>
+	/// Queue a packet shared by several clients on one of their peers. A peer that has fewer channels than the packet's
+	/// gets the escaped copy instead, made by the first peer that needs it
+	/// </summary>
+	/// <param name="peer"></param>
+	/// <param name="channel"></param>
+	/// <param name="packet"></param>
+	/// <param name="escaped"></param>
+
+	void Server::sendPacketShared(ENetPeer* peer, const LNetByte& channel, ENetPacket* packet, ENetPacket*& escaped)
+	{
+		if (channel < peer->channelCount)
+		{
+			enet_peer_send(peer, channel, packet);
+			return;
+		}
+
+		// The escape holds the real channel, so the copy fits every peer whatever channel carries it
+		if (!escaped)
+		{
+			escaped = Message::channelEscapedCopy(packet, channel);
+
+			if (!escaped)
+			{
+				releasePacketShared(packet, nullptr);
+				throw std::runtime_error("Couldn't create packet.");
+			}
+		}
+
+		enet_peer_send(peer, channel % peer->channelCount, escaped);
+	}
+
+	/// <summary>
+	/// Destroy the shared packet and its escaped copy if no peer took them
+	/// </summary>
+	/// <param name="packet"></param>
+	/// <param name="escaped"></param>
+
+	void Server::releasePacketShared(ENetPacket* packet, ENetPacket* escaped)
+	{
+		// Nobody holds a reference, so enet won't free them
+		if (packet->referenceCount == 0)
+		{
+			enet_packet_destroy(packet);
+		}
+
+		if (escaped && escaped->referenceCount == 0)
+		{
+			enet_packet_destroy(escaped);
+		}
 	}
-}
\ No newline at end of file
+}
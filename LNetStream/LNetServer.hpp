@@ -3,10 +3,22 @@
 
 #include <cassert>
 #include <unordered_map>
+#include "LNetAggregator.hpp"
+#include "LNetChecksum.hpp"
+#include "LNetCompression.hpp"
+#include "LNetMemoryFootprint.hpp"
+#include "LNetPeerStats.hpp"
+#include "LNetTickBudget.hpp"
 #include "LNetEndianHandler.hpp"
+#include "LNetDispatchTable.hpp"
 #include "LNetMessage.hpp"
+#include "LNetNetworkThread.hpp"
+#include "LNetMpscQueue.hpp"
+#include "LNetSpscQueue.hpp"
 #include "LNetTypes.hpp"
-#include <queue>
+#include "LNetClientTable.hpp"
+#include <deque>
+#include <mutex>
 
 namespace lnet
 {
@@ -15,13 +27,22 @@ namespace lnet
 		// should match the client
 		LNetByte channels;
 
+		// channels enet allocates per peer (at most channels), the ones above are carried over them
+		LNetByte physicalChannels;
+
 		LNet4Byte maxConnections;
 		
 		// any address
 		ENetAddress address;
 
+		// none by default, should match the client
+		CompressionSettings compression;
+
+		// CRC32C of every datagram, checked by enet, off by default, should match the client
+		bool checksum = false;
+
 		ServerSettings(const LNet4Byte& maxConnections, const LNetByte& channels)
-			: maxConnections(maxConnections), channels(channels), address{ENET_HOST_ANY, 0}
+			: maxConnections(maxConnections), channels(channels), physicalChannels(channels), address{ENET_HOST_ANY, 0}
 		{
 			// only if channels has a correct value
 			assert(channels < 255);
@@ -29,6 +50,9 @@ namespace lnet
 	};
 
 
+	// Data a rejected peer's disconnection carries
+	constexpr LNet4Byte LNET_DISCONNECT_REJECTED = 1;
+
 	class Server
 	{
 	public:
@@ -37,29 +61,121 @@ namespace lnet
 		
 		using LNetReadCallback = std::function<void(const LNet4Byte&, Message&)>;
 
+		// Decides whether a connecting peer becomes a client, from the token it connected with (Client::connect) and its address
+		using LNetConnectValidator = std::function<bool(const LNet4Byte& token, const ENetAddress& address)>;
+
+		using LNetDisconnectCallback = std::function<void(const LNet4Byte& clientID)>;
+
 		void listen(const LNet2Byte& port);
 
 		void tick();
+
+		// Services the host as tick() does (so enet's timing never suffers), handles connections and disconnections,
+		// then calls message callbacks until the budget runs out: priority channels first, the rest in order.
+		// Messages left over are called first by the next tick, at least one is called per tick whatever the budget
+		void tick(const TickBudget& budget);
+
+		// Messages on priority channels are called before the others (from the thread calling tick())
+		void setPriorityChannel(const LNetByte& channel, const bool isPriority = true);
+
+		// Received messages still waiting for their callback
+		size_t getDeferredMessageCount() const;
+
+		// Most received messages waiting for their callback, the ones arriving past it are dropped, reliable ones included.
+		// For budgeted ticks that would rather lose messages than fall behind for good (from the thread calling tick(), no limit by default)
+		void setMaxDeferredMessages(const size_t count);
+
+		// Received messages dropped because too many were waiting
+		size_t getDroppedMessageCount() const;
 		
 		void terminate();
 
+		// Run the host on its own thread, blocking in enet_host_service up to serviceTimeout milliseconds.
+		// tick() then only calls the callbacks of what that thread received, and sends are handed to it.
+		// Start and stop it from the thread calling tick()
+		void startNetworkThread(const LNet4Byte& serviceTimeout = LNET_DEFAULT_SERVICE_TIMEOUT);
+		void stopNetworkThread();
+
+		// Pack the small messages sent to a peer on one channel during a tick into container packets of at most
+		// maxContainerSize bytes, 0 sends every message in its own packet (off by default, any thread)
+		void setAggregation(const size_t maxContainerSize = LNET_DEFAULT_CONTAINER_SIZE);
+
+		// Compress the host's datagrams, takes effect at the next listen() (or now when already listening, without a network thread)
+		void setCompression(const CompressionSettings& compression);
+		CompressionStats getCompressionStats() const;
+
+		// Have enet allocate only the first count channels of every peer (they cost memory for every connected client).
+		// Messages on the other channels share them, in order with the channel they land on. Takes effect at the next listen()
+		void setPhysicalChannels(const LNetByte& count);
+
+		// What enet keeps for the host and all its peer slots, or for one client (thread owning the host)
+		MemoryFootprint getMemoryFootprint() const;
+		MemoryFootprint getClientMemoryFootprint(const LNet4Byte& clientID) const;
+
+		// What enet measured about a client's connection, empty when the ID is unknown or stale.
+		// Any thread, a copy the thread owning the host refreshes every tick or LNET_STATS_PUBLISH_INTERVAL
+		PeerStats getClientStats(const LNet4Byte& clientID) const;
+
+		// The enet host, for loops that service it themselves (see AsioService)
+		ENetHost* getHost() const;
+
+		// Called after every send queued without a network thread, so an outside loop can service the host soon.
+		// Set it before sending from other threads
+		void setOnSendQueued(const std::function<void()>& func);
+
+		// Whether the thread that called tick() keeps owning the host between ticks and sends directly (the default).
+		// Off for loops that tick from a thread pool (see AsioService): that thread may send later from outside the loop,
+		// so only the sends made during tick() are direct and the others are queued for the next one
+		void setTickThreadOwnsHost(const bool owns);
+
+		// Have enet drop corrupted datagrams (CRC32C), takes effect at the next listen() (or now when already listening, without a network thread)
+		void setChecksum(const bool enabled);
+
 		void setMessageCallback(const MessageIdentifier& identifier, const LNetReadCallback& func);
 		void removeMessageCallback(const MessageIdentifier& identifier);
 
+		// Called for every connecting peer before it is added to the clients, on the thread servicing the host.
+		// A rejected peer is disconnected at once (with LNET_DISCONNECT_REJECTED). Set it before listen()
+		void setConnectValidator(const LNetConnectValidator& func);
+
+		// Called with the ID of every client that disconnected, by tick() after the client's last message, so per client
+		// state kept next to the server can be dropped (thread calling tick()). Returns the handle to remove it with
+		LNet4Byte addDisconnectCallback(const LNetDisconnectCallback& func);
+		void removeDisconnectCallback(const LNet4Byte& handle);
+
+		// The token the client connected with, 0 when the ID is unknown or stale (thread servicing the host)
+		LNet4Byte getClientToken(const LNet4Byte& clientID) const;
+
 		void sendClient(const LNet4Byte& clientID, const Message& message);
+		// A packet holding a message's network form (Message::toNetworkPacket), the server owns it from now on
+		void sendClientPacket(const LNet4Byte& clientID, const LNetByte& channel, ENetPacket* packet);
+		template<typename... Args>
+		void sendClient(const LNet4Byte& clientID, const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
 		template<typename... Args>
 		void sendReliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
 		template<typename... Args>
 		void sendUnreliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
 		
+		void sendClients(const std::vector<LNet4Byte>& clientIDs, const Message& message);
+		template<typename... Args>
+		void sendClients(const std::vector<LNet4Byte>& clientIDs, const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
+		void sendReliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
+		void sendUnreliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+
 		void sendBroadcastExcept(const LNet4Byte& clientID, const Message& message);
 		template<typename... Args>
+		void sendBroadcastExcept(const LNet4Byte& excludedClientID, const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
 		void sendReliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
 		template<typename... Args>
 		void sendUnreliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
 		
 		void sendBroadcast(const Message& message);
 		template<typename... Args>
+		void sendBroadcast(const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
 		void sendReliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args&... args);
 		template<typename... Args>
 		void sendUnreliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args&... args);
@@ -68,6 +184,30 @@ namespace lnet
 
 	private:
 
+		// A client's stats as the thread owning the host last copied them, per slot
+		struct PublishedStats
+		{
+			LNet4Byte clientID = 0;
+			bool isConnected = false;
+			PeerStats stats;
+		};
+
+		// A message the network thread received, waiting for tick() to call its callback
+		struct ReceivedMessage
+		{
+			LNet4Byte clientID = 0;
+			Message message;
+
+			// No message, the client disconnected after the ones before it
+			bool disconnected = false;
+		};
+
+		/// <summary>
+		/// Handle any enet event (connect, disconnect, receive)
+		/// </summary>
+		/// <param name="event"></param>
+		void handleEvent(const ENetEvent& event);
+
 		/// <summary>
 		/// Handle the connection and saves it in the clients object
 		/// </summary>
@@ -87,10 +227,115 @@ namespace lnet
 		void handleReceive(const ENetEvent& event);
 
 		/// <summary>
-		/// Uses a binary search to find the lowest value that the clients ID do not use
+		/// Drop a stale LatestOnly message, keep the others for the callbacks of tick()
+		/// </summary>
+		/// <param name="peer"></param>
+		/// <param name="message"></param>
+		void receiveMessage(const ENetPeer* peer, Message& message);
+
+		/// <summary>
+		/// Hand a received message to tick(), directly or through the network thread's queue
+		/// </summary>
+		/// <param name="received"></param>
+		void queueReceived(ReceivedMessage&& received);
+
+		/// <summary>
+		/// Call the disconnect callbacks for a client (thread calling tick())
+		/// </summary>
+		/// <param name="clientID"></param>
+		void dispatchDisconnect(const LNet4Byte& clientID);
+
+		/// <summary>
+		/// Call the message's callback if it has one
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <param name="message"></param>
+		void dispatchMessage(const LNet4Byte& clientID, Message& message);
+
+		/// <summary>
+		/// Keep a received message for the callbacks of this tick or the next ones (thread calling tick())
+		/// </summary>
+		/// <param name="received"></param>
+		void deferMessage(ReceivedMessage&& received);
+
+		/// <summary>
+		/// Call the callbacks of deferred messages until the budget runs out, priority channels first
+		/// </summary>
+		/// <param name="budget"></param>
+		/// <param name="start"></param>
+		void dispatchDeferred(const TickBudget& budget, const std::chrono::steady_clock::time_point& start);
+
+		/// <summary>
+		/// Send the packet now when called by the thread owning the host, otherwise queue it for that thread (any thread)
+		/// </summary>
+		/// <param name="command"></param>
+		void queueSend(SendCommand&& command);
+
+		/// <summary>
+		/// Queue the command's packet on its peers, on the thread that owns the host
+		/// </summary>
+		/// <param name="command"></param>
+		void executeSend(SendCommand& command);
+
+		/// <summary>
+		/// Stamp a LatestOnly packet with the sequence of its peers, a peer too far behind the shared sequence is sent its own copy
+		/// </summary>
+		/// <param name="command"></param>
+		void stampLatestOnly(SendCommand& command);
+
+		/// <summary>
+		/// Copy the command's small packet into its client's container, then destroy it
+		/// </summary>
+		/// <param name="command"></param>
+		void aggregateSend(SendCommand& command);
+
+		/// <summary>
+		/// Send everything other threads queued, in one batch (thread owning the host only)
+		/// </summary>
+		void executeQueuedSends();
+
+		/// <summary>
+		/// Network thread, runs before every enet_host_service (sends what was queued, retries received messages that didn't fit)
+		/// </summary>
+		void beforeService();
+
+		/// <summary>
+		/// Copy every connected client's stats for the other threads (thread owning the host)
+		/// </summary>
+		void publishStats();
+
+		/// <summary>
+		/// Queue one packet on every listed client (enet reference counts it), destroys it if no client took it
 		/// </summary>
-		/// <returns>The ID as LNet4Byte (4 Bytes of possible IDs)</returns>
-		const LNet4Byte newClientID();
+		/// <param name="clientIDs"></param>
+		/// <param name="channel"></param>
+		/// <param name="packet"></param>
+		void sendPacketClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, ENetPacket* packet);
+
+		/// <summary>
+		/// Queue one packet on every client, except the excluded one when there is one, destroys it if no client took it
+		/// </summary>
+		/// <param name="excludedClientID"></param>
+		/// <param name="channel"></param>
+		/// <param name="packet"></param>
+		void sendPacketBroadcast(const LNet4Byte* excludedClientID, const LNetByte& channel, ENetPacket* packet);
+
+		/// <summary>
+		/// Queue a packet shared by several clients on one of their peers. A peer that has fewer channels than the packet's
+		/// gets the escaped copy instead, made by the first peer that needs it
+		/// </summary>
+		/// <param name="peer"></param>
+		/// <param name="channel"></param>
+		/// <param name="packet"></param>
+		/// <param name="escaped"></param>
+		void sendPacketShared(ENetPeer* peer, const LNetByte& channel, ENetPacket* packet, ENetPacket*& escaped);
+
+		/// <summary>
+		/// Destroy the shared packet and its escaped copy if no peer took them
+		/// </summary>
+		/// <param name="packet"></param>
+		/// <param name="escaped"></param>
+		static void releasePacketShared(ENetPacket* packet, ENetPacket* escaped);
 	
 
 	private:
@@ -99,76 +344,135 @@ namespace lnet
 
 		ENetHost* host;
 
-		// all connections with ID
-		std::unordered_map<LNet4Byte, ENetPeer*> clients;
-
-		std::queue<LNet4Byte> possibleIDs;
-		LNet4Byte currentClientID = 0;
+		// all connections, indexed by the peer's slot in the host
+		ClientTable clients;
 		
 		// Message callbacks
-		std::unordered_map<MessageIdentifier, LNetReadCallback, HashMessageIdentifier> messageCallbacks;
+		DispatchTable<LNetReadCallback> messageCallbacks;
+
+		LNetConnectValidator connectValidator;
+
+		// handle -> callback (thread calling tick())
+		std::vector<std::pair<LNet4Byte, LNetDisconnectCallback>> disconnectCallbacks;
+		LNet4Byte nextDisconnectCallbackHandle = 0;
+
+		// Network thread mode
+		NetworkThread networkThread;
+		std::atomic<bool> useNetworkThread = false;
+
+		// Thread that last called tick(), without a network thread it owns the host and sends directly
+		std::atomic<std::thread::id> tickThread;
+		std::atomic<bool> tickThreadOwnsHost = true;
+
+		// network thread -> tick()
+		SpscQueue<ReceivedMessage> receivedMessages;
+		// Received messages that didn't fit in the queue (network thread only)
+		std::deque<ReceivedMessage> receivedOverflow;
+
+		// Received messages waiting for their callback (thread calling tick())
+		std::deque<ReceivedMessage> priorityMessages;
+		std::deque<ReceivedMessage> deferredMessages;
+		std::array<bool, 256> priorityChannels{};
+		size_t maxDeferredMessages = LNET_DEFAULT_MAX_DEFERRED_MESSAGES;
+		size_t droppedMessages = 0;
 
+		// send functions on any thread -> thread owning the host
+		MpscQueue<SendCommand> sendCommands{ LNET_SEND_QUEUE_CAPACITY };
+		// Sends that found the queue full, a sender never waits for room (nothing may be draining it)
+		std::mutex sendOverflowMutex;
+		std::deque<SendCommand> sendOverflow;
+		std::atomic<bool> hasSendOverflow = false;
+		std::function<void()> onSendQueued;
+
+		// Small messages waiting to be sent together (thread owning the host only)
+		Aggregator aggregator;
+
+		// thread owning the host -> getClientStats(), indexed by slot
+		mutable std::mutex statsMutex;
+		std::vector<PublishedStats> publishedStats;
+		std::chrono::steady_clock::time_point lastStatsPublish;
+
+		// The host's compressor
+		Compression compression;
 	};
 
 	// template sending functions
 
+	template<typename ...Args>
+	void Server::sendClient(const LNet4Byte& clientID, const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		Message message = Message::createByArgs(mode, channel, type, args...);
+		queueSend({ SendTarget::Client, clientID, {}, channel, message.toNetworkPacket() });
+	}
+	template<typename ...Args>
+	void Server::sendClients(const std::vector<LNet4Byte>& clientIDs, const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		Message message = Message::createByArgs(mode, channel, type, args...);
+		queueSend({ SendTarget::Clients, 0, clientIDs, channel, message.toNetworkPacket() });
+	}
+	template<typename ...Args>
+	void Server::sendBroadcastExcept(const LNet4Byte& excludedClientID, const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		Message message = Message::createByArgs(mode, channel, type, args...);
+		queueSend({ SendTarget::BroadcastExcept, excludedClientID, {}, channel, message.toNetworkPacket() });
+	}
+	template<typename ...Args>
+	void Server::sendBroadcast(const DeliveryMode& mode, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		Message message = Message::createByArgs(mode, channel, type, args...);
+		queueSend({ SendTarget::Broadcast, 0, {}, channel, message.toNetworkPacket() });
+	}
+
 	template<typename ...Args>
 	void Server::sendReliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
 	{
 		Message message = Message::createByArgs(true, channel, type, args...);
-		ENetPacket* packet = message.toNetworkPacket();
-		enet_peer_send(clients[clientID], channel, packet);
+		queueSend({ SendTarget::Client, clientID, {}, channel, message.toNetworkPacket() });
 	}
 	template<typename ...Args>
 	void Server::sendUnreliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
 	{
 		Message message = Message::createByArgs(false, channel, type, args...);
-		ENetPacket* packet = message.toNetworkPacket();
-		enet_peer_send(clients[clientID], channel, packet);
+		queueSend({ SendTarget::Client, clientID, {}, channel, message.toNetworkPacket() });
 	}
 
 	template<typename ...Args>
-	void Server::sendReliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	void Server::sendReliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
 	{
 		Message message = Message::createByArgs(true, channel, type, args...);
+		queueSend({ SendTarget::Clients, 0, clientIDs, channel, message.toNetworkPacket() });
+	}
+	template<typename ...Args>
+	void Server::sendUnreliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		Message message = Message::createByArgs(false, channel, type, args...);
+		queueSend({ SendTarget::Clients, 0, clientIDs, channel, message.toNetworkPacket() });
+	}
 
-		for (auto& client : clients)
-		{
-			if (client.first != excludedClientID)
-			{
-				ENetPacket* packet = message.toNetworkPacket();
-				enet_peer_send(client.second, channel, packet);
-			}
-		}
+	template<typename ...Args>
+	void Server::sendReliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		Message message = Message::createByArgs(true, channel, type, args...);
+		queueSend({ SendTarget::BroadcastExcept, excludedClientID, {}, channel, message.toNetworkPacket() });
 	}
 	template<typename ...Args>
 	void Server::sendUnreliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
 	{
 		Message message = Message::createByArgs(false, channel, type, args...);
-
-		for (auto& client : clients)
-		{
-			if (client.first != excludedClientID)
-			{
-				ENetPacket* packet = message.toNetworkPacket();
-				enet_peer_send(client.second, channel, packet);
-			}
-		}
+		queueSend({ SendTarget::BroadcastExcept, excludedClientID, {}, channel, message.toNetworkPacket() });
 	}
 
 	template<typename ...Args>
 	void Server::sendReliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
 	{
 		Message message = Message::createByArgs(true, channel, type, args...);  // Create reliable message
-		ENetPacket* packet = message.toNetworkPacket();
-		enet_host_broadcast(host, channel, packet);
+		queueSend({ SendTarget::Broadcast, 0, {}, channel, message.toNetworkPacket() });
 	}
 	template<typename ...Args>
 	void Server::sendUnreliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
 	{
 		Message message = Message::createByArgs(false, channel, type, args...);  // Create unreliable message
-		ENetPacket* packet = message.toNetworkPacket();
-		enet_host_broadcast(host, channel, packet);
+		queueSend({ SendTarget::Broadcast, 0, {}, channel, message.toNetworkPacket() });
 	}
 
 }
@@ -0,0 +1,210 @@
+#include "LNetShardedServer.hpp"
+
+namespace lnet
+{
+	ShardedServer::ShardedServer(const LNetByte& shardCount, const LNet4Byte& maxConnectionsPerShard, const LNetByte& channels)
+	{
+		if (shardCount == 0)
+		{
+			throw std::runtime_error("Sharded server needs at least one shard.");
+		}
+
+		shards.reserve(shardCount);
+
+		for (LNetByte shard = 0; shard < shardCount; shard++)
+		{
+			shards.push_back(std::make_unique<Server>(maxConnectionsPerShard, channels));
+		}
+	}
+
+	void ShardedServer::listen(const LNet2Byte& firstPort, const LNet4Byte& serviceTimeout)
+	{
+		for (size_t shard = 0; shard < shards.size(); shard++)
+		{
+			shards[shard]->listen(static_cast<LNet2Byte>(firstPort + shard));
+			shards[shard]->startNetworkThread(serviceTimeout);
+		}
+	}
+
+	void ShardedServer::tick()
+	{
+		for (auto& shard : shards)
+		{
+			shard->tick();
+		}
+	}
+
+	void ShardedServer::terminate()
+	{
+		for (auto& shard : shards)
+		{
+			shard->terminate();
+		}
+	}
+
+	// MESSAGE CALLBACKS
+
+	void ShardedServer::setMessageCallback(const MessageIdentifier& identifier, const LNetReadCallback& func)
+	{
+		for (size_t shard = 0; shard < shards.size(); shard++)
+		{
+			// Shards know their clients by their own IDs, give the callback the sharded ID
+			shards[shard]->setMessageCallback(identifier,
+				[shard, func](const LNet4Byte& shardClientID, Message& message)
+				{
+					func(toClientID(static_cast<LNetByte>(shard), shardClientID), message);
+				}
+			);
+		}
+	}
+	void ShardedServer::removeMessageCallback(const MessageIdentifier& identifier)
+	{
+		for (auto& shard : shards)
+		{
+			shard->removeMessageCallback(identifier);
+		}
+	}
+
+	void ShardedServer::setConnectValidator(const Server::LNetConnectValidator& func)
+	{
+		for (auto& shard : shards)
+		{
+			shard->setConnectValidator(func);
+		}
+	}
+
+	// Called with the sharded ID of every client that disconnected, by tick(). Returns the handle to remove it with
+
+	LNet4Byte ShardedServer::addDisconnectCallback(const Server::LNetDisconnectCallback& func)
+	{
+		LNet4Byte handle = 0;
+
+		// Only this adds callbacks to the shards, so they all hand out the same handle
+		for (size_t shard = 0; shard < shards.size(); shard++)
+		{
+			handle = shards[shard]->addDisconnectCallback(
+				[shard, func](const LNet4Byte& shardClientID)
+				{
+					func(toClientID(static_cast<LNetByte>(shard), shardClientID));
+				}
+			);
+		}
+
+		return handle;
+	}
+	void ShardedServer::removeDisconnectCallback(const LNet4Byte& handle)
+	{
+		for (auto& shard : shards)
+		{
+			shard->removeDisconnectCallback(handle);
+		}
+	}
+
+	// SEND FUNCTIONS
+
+	void ShardedServer::sendClient(const LNet4Byte& clientID, const Message& message)
+	{
+		Server* shard = shardOfClient(clientID);
+
+		if (shard)
+		{
+			shard->sendClient(shardClientIDOf(clientID), message);
+		}
+	}
+
+	void ShardedServer::sendClients(const std::vector<LNet4Byte>& clientIDs, const Message& message)
+	{
+		std::vector<std::vector<LNet4Byte>> shardClientIDs(shards.size());
+
+		for (const LNet4Byte& clientID : clientIDs)
+		{
+			if (shardOf(clientID) < shards.size())
+			{
+				shardClientIDs[shardOf(clientID)].push_back(shardClientIDOf(clientID));
+			}
+		}
+
+		for (size_t shard = 0; shard < shards.size(); shard++)
+		{
+			if (!shardClientIDs[shard].empty())
+			{
+				shards[shard]->sendClients(shardClientIDs[shard], message);
+			}
+		}
+	}
+
+	void ShardedServer::sendBroadcastExcept(const LNet4Byte& clientID, const Message& message)
+	{
+		for (size_t shard = 0; shard < shards.size(); shard++)
+		{
+			if (shard == shardOf(clientID))
+			{
+				shards[shard]->sendBroadcastExcept(shardClientIDOf(clientID), message);
+			}
+			else
+			{
+				shards[shard]->sendBroadcast(message);
+			}
+		}
+	}
+
+	void ShardedServer::sendBroadcast(const Message& message)
+	{
+		for (auto& shard : shards)
+		{
+			shard->sendBroadcast(message);
+		}
+	}
+
+	LNetByte ShardedServer::getShardCount() const
+	{
+		return static_cast<LNetByte>(shards.size());
+	}
+
+	// STATIC
+
+	LNet2Byte ShardedServer::shardPort(const LNet2Byte& firstPort, const LNetByte& shardCount, const LNet4Byte& key)
+	{
+		if (shardCount == 0)
+		{
+			throw std::runtime_error("Sharded server needs at least one shard.");
+		}
+
+		return static_cast<LNet2Byte>(firstPort + key % shardCount);
+	}
+
+	LNet4Byte ShardedServer::toClientID(const LNetByte& shard, const LNet4Byte& shardClientID)
+	{
+		assert(shardClientID <= LNET_SHARD_CLIENT_MASK);
+
+		return (static_cast<LNet4Byte>(shard) << (32 - LNET_SHARD_BITS)) | shardClientID;
+	}
+
+	LNetByte ShardedServer::shardOf(const LNet4Byte& clientID)
+	{
+		return static_cast<LNetByte>(clientID >> (32 - LNET_SHARD_BITS));
+	}
+
+	LNet4Byte ShardedServer::shardClientIDOf(const LNet4Byte& clientID)
+	{
+		return clientID & LNET_SHARD_CLIENT_MASK;
+	}
+
+	ShardedServer::~ShardedServer()
+	{
+		terminate();
+	}
+
+	/// <summary>
+	/// The shard owning the client, nullptr when the ID points to no shard
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <returns></returns>
+
+	Server* ShardedServer::shardOfClient(const LNet4Byte& clientID)
+	{
+		LNetByte shard = shardOf(clientID);
+
+		return shard < shards.size() ? shards[shard].get() : nullptr;
+	}
+}
@@ -0,0 +1,143 @@
+#ifndef LNET_SHARDED_SERVER_HPP
+#define LNET_SHARDED_SERVER_HPP
+
+#include <memory>
+#include <vector>
+#include "LNetServer.hpp"
+
+namespace lnet
+{
+	// Top bits of a sharded client ID hold the shard, the rest is the client ID inside that shard
+	constexpr int LNET_SHARD_BITS = 8;
+	constexpr LNet4Byte LNET_MAX_SHARDS = 1u << LNET_SHARD_BITS;
+	constexpr LNet4Byte LNET_SHARD_CLIENT_MASK = (1u << (32 - LNET_SHARD_BITS)) - 1;
+
+	// Runs one Server (one ENetHost) per shard, each on its own network thread, shard i listens on firstPort + i.
+	// A client belongs to the shard it connected to, its client ID carries the shard so IDs are unique across shards.
+	// Callbacks are called by tick(), on the thread calling it; the send functions can be called from any thread
+	class ShardedServer
+	{
+	public:
+		ShardedServer(const LNetByte& shardCount, const LNet4Byte& maxConnectionsPerShard = 1000,
+			const LNetByte& channels = 16);
+
+		using LNetReadCallback = Server::LNetReadCallback;
+
+		void listen(const LNet2Byte& firstPort, const LNet4Byte& serviceTimeout = LNET_DEFAULT_SERVICE_TIMEOUT);
+
+		// Calls the callbacks of what every shard received
+		void tick();
+
+		void terminate();
+
+		void setMessageCallback(const MessageIdentifier& identifier, const LNetReadCallback& func);
+		void removeMessageCallback(const MessageIdentifier& identifier);
+
+		// Same validator on every shard, called on the shard's network thread
+		void setConnectValidator(const Server::LNetConnectValidator& func);
+
+		// Called with the sharded ID of every client that disconnected, by tick(). Returns the handle to remove it with
+		LNet4Byte addDisconnectCallback(const Server::LNetDisconnectCallback& func);
+		void removeDisconnectCallback(const LNet4Byte& handle);
+
+		void sendClient(const LNet4Byte& clientID, const Message& message);
+		template<typename... Args>
+		void sendReliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
+		void sendUnreliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+
+		// One packet per shard that has any of the clients
+		void sendClients(const std::vector<LNet4Byte>& clientIDs, const Message& message);
+		template<typename... Args>
+		void sendReliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
+		void sendUnreliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+
+		// Cross shard broadcasts, one packet per shard (enet packet reference counts are not shared between threads)
+		void sendBroadcastExcept(const LNet4Byte& clientID, const Message& message);
+		template<typename... Args>
+		void sendReliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
+		void sendUnreliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+
+		void sendBroadcast(const Message& message);
+		template<typename... Args>
+		void sendReliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+		template<typename... Args>
+		void sendUnreliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args&... args);
+
+		LNetByte getShardCount() const;
+
+		// Port a client should connect to, spreads clients over the shards by a key of the client's choice (account ID, random...).
+		// Throws when shardCount is 0
+		static LNet2Byte shardPort(const LNet2Byte& firstPort, const LNetByte& shardCount, const LNet4Byte& key);
+
+		// Client ID <-> (shard, client ID inside the shard)
+		static LNet4Byte toClientID(const LNetByte& shard, const LNet4Byte& shardClientID);
+		static LNetByte shardOf(const LNet4Byte& clientID);
+		static LNet4Byte shardClientIDOf(const LNet4Byte& clientID);
+
+		~ShardedServer();
+
+	private:
+
+		/// <summary>
+		/// The shard owning the client, nullptr when the ID points to no shard
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <returns></returns>
+		Server* shardOfClient(const LNet4Byte& clientID);
+
+	private:
+
+		std::vector<std::unique_ptr<Server>> shards;
+	};
+
+	// template sending functions
+
+	template<typename ...Args>
+	void ShardedServer::sendReliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendClient(clientID, Message::createByArgs(true, channel, type, args...));
+	}
+	template<typename ...Args>
+	void ShardedServer::sendUnreliableClient(const LNet4Byte& clientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendClient(clientID, Message::createByArgs(false, channel, type, args...));
+	}
+
+	template<typename ...Args>
+	void ShardedServer::sendReliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendClients(clientIDs, Message::createByArgs(true, channel, type, args...));
+	}
+	template<typename ...Args>
+	void ShardedServer::sendUnreliableClients(const std::vector<LNet4Byte>& clientIDs, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendClients(clientIDs, Message::createByArgs(false, channel, type, args...));
+	}
+
+	template<typename ...Args>
+	void ShardedServer::sendReliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendBroadcastExcept(excludedClientID, Message::createByArgs(true, channel, type, args...));
+	}
+	template<typename ...Args>
+	void ShardedServer::sendUnreliableBroadcastExcept(const LNet4Byte& excludedClientID, const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendBroadcastExcept(excludedClientID, Message::createByArgs(false, channel, type, args...));
+	}
+
+	template<typename ...Args>
+	void ShardedServer::sendReliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendBroadcast(Message::createByArgs(true, channel, type, args...));
+	}
+	template<typename ...Args>
+	void ShardedServer::sendUnreliableBroadcast(const LNetByte& channel, const LNet2Byte& type, const Args & ...args)
+	{
+		sendBroadcast(Message::createByArgs(false, channel, type, args...));
+	}
+}
+
+#endif
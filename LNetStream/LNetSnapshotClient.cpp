@@ -0,0 +1,64 @@
+#include "LNetSnapshotClient.hpp"
+
+namespace lnet
+{
+	SnapshotClient::SnapshotClient(Client& client, const LNetSnapshotCallback& func, const LNetByte& channel) :
+		client(client),
+		channel(channel),
+		callback(func)
+	{
+		client.setMessageCallback({ channel, LNET_TYPE_SNAPSHOT },
+			[this](Message& message) { handleSnapshot(message); });
+	}
+
+	SnapshotClient::~SnapshotClient()
+	{
+		client.removeMessageCallback({ channel, LNET_TYPE_SNAPSHOT });
+	}
+
+	/// <summary>
+	/// Rebuild a received snapshot, acknowledge it and call the callback (drops it when its baseline is gone)
+	/// </summary>
+	/// <param name="message"></param>
+
+	void SnapshotClient::handleSnapshot(Message& message)
+	{
+		SnapshotDelta::Header header;
+		Snapshot* snapshot;
+
+		try
+		{
+			header = SnapshotDelta::readHeader(message);
+
+			const SnapshotState* baseline = nullptr;
+			if (header.baselineSequence != LNET_SNAPSHOT_NO_BASELINE)
+			{
+				const Snapshot& base = snapshots[header.baselineSequence % LNET_SNAPSHOT_HISTORY];
+
+				// Already overwritten, the server sends it whole once the acks move on
+				if (base.sequence != header.baselineSequence || header.sequence - header.baselineSequence >= LNET_SNAPSHOT_HISTORY)
+				{
+					return;
+				}
+
+				baseline = &base.state;
+			}
+
+			snapshot = &snapshots[header.sequence % LNET_SNAPSHOT_HISTORY];
+
+			// Not valid until it's fully read
+			snapshot->sequence = LNET_SNAPSHOT_NO_BASELINE;
+			SnapshotDelta::readState(message, header, baseline, snapshot->state);
+			snapshot->sequence = header.sequence;
+		}
+		catch (const std::runtime_error&)
+		{
+			// Malformed, drop it
+			return;
+		}
+
+		client.send(DeliveryMode::LatestOnly, { channel, LNET_TYPE_SNAPSHOT_ACK }, header.sequence);
+
+		callback(header.sequence, snapshot->state);
+	}
+}
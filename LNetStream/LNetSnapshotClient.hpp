@@ -0,0 +1,49 @@
+#ifndef LNET_SNAPSHOT_CLIENT_HPP
+#define LNET_SNAPSHOT_CLIENT_HPP
+
+#include <array>
+#include "LNetClient.hpp"
+#include "LNetSnapshotDelta.hpp"
+
+namespace lnet
+{
+	// Receives SnapshotServer's snapshots, rebuilds them from their baselines and acknowledges every one it applied.
+	// The callback is called by the client's tick()
+	class SnapshotClient
+	{
+	public:
+		using LNetSnapshotCallback = std::function<void(const LNet4Byte& sequence, std::span<const LNetByte> state)>;
+
+		SnapshotClient(Client& client, const LNetSnapshotCallback& func, const LNetByte& channel = 0);
+
+		SnapshotClient(const SnapshotClient&) = delete;
+		SnapshotClient& operator=(const SnapshotClient&) = delete;
+
+		~SnapshotClient();
+
+	private:
+
+		struct Snapshot
+		{
+			LNet4Byte sequence = LNET_SNAPSHOT_NO_BASELINE;
+			SnapshotState state;
+		};
+
+		/// <summary>
+		/// Rebuild a received snapshot, acknowledge it and call the callback (drops it when its baseline is gone)
+		/// </summary>
+		/// <param name="message"></param>
+		void handleSnapshot(Message& message);
+
+	private:
+
+		Client& client;
+		LNetByte channel;
+
+		LNetSnapshotCallback callback;
+
+		std::array<Snapshot, LNET_SNAPSHOT_HISTORY> snapshots;
+	};
+}
+
+#endif
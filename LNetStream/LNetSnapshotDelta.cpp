@@ -0,0 +1,101 @@
+#include "LNetSnapshotDelta.hpp"
+#include <algorithm>
+
+namespace lnet
+{
+	// Write the snapshot as a delta against the baseline, or whole when there is no baseline,
+	// its size differs, or the delta wouldn't be smaller
+
+	void SnapshotDelta::write(Message& message, const LNet4Byte& sequence, const LNet4Byte& baselineSequence,
+		const SnapshotState* baseline, std::span<const LNetByte> state)
+	{
+		const size_t words = (state.size() + LNET_SNAPSHOT_WORD_SIZE - 1) / LNET_SNAPSHOT_WORD_SIZE;
+
+		std::vector<LNetByte> mask;
+		size_t changedBytes = 0;
+
+		const bool canDelta = baseline && baseline->size() == state.size();
+		if (canDelta)
+		{
+			mask.assign((words + 7) / 8, 0);
+
+			for (size_t word = 0; word < words; word++)
+			{
+				size_t offset = word * LNET_SNAPSHOT_WORD_SIZE;
+				size_t length = std::min(LNET_SNAPSHOT_WORD_SIZE, state.size() - offset);
+
+				if (std::memcmp(state.data() + offset, baseline->data() + offset, length) != 0)
+				{
+					mask[word / 8] |= static_cast<LNetByte>(1 << (word % 8));
+					changedBytes += length;
+				}
+			}
+		}
+
+		if (!canDelta || mask.size() + changedBytes >= state.size())
+		{
+			message << sequence << LNET_SNAPSHOT_NO_BASELINE << static_cast<LNet4Byte>(state.size());
+			message.writeBytes(state.data(), state.size());
+			return;
+		}
+
+		message << sequence << baselineSequence << static_cast<LNet4Byte>(state.size());
+		message.writeBytes(mask.data(), mask.size());
+
+		for (size_t word = 0; word < words; word++)
+		{
+			if (mask[word / 8] & (1 << (word % 8)))
+			{
+				size_t offset = word * LNET_SNAPSHOT_WORD_SIZE;
+				message.writeBytes(state.data() + offset, std::min(LNET_SNAPSHOT_WORD_SIZE, state.size() - offset));
+			}
+		}
+	}
+
+	SnapshotDelta::Header SnapshotDelta::readHeader(Message& message)
+	{
+		Header header;
+
+		message >> header.sequence >> header.baselineSequence >> header.size;
+
+		return header;
+	}
+
+	// Read the state after the header, baseline is the snapshot the header names (nullptr for a whole snapshot)
+
+	void SnapshotDelta::readState(Message& message, const Header& header, const SnapshotState* baseline, SnapshotState& state)
+	{
+		if (header.baselineSequence == LNET_SNAPSHOT_NO_BASELINE)
+		{
+			if (header.size > message.getReadRemaining())
+			{
+				throw std::runtime_error("Snapshot is bigger than its message.");
+			}
+
+			state.resize(header.size);
+			message.readBytes(state.data(), state.size());
+			return;
+		}
+
+		if (!baseline || baseline->size() != header.size)
+		{
+			throw std::runtime_error("Snapshot baseline doesn't match.");
+		}
+
+		const size_t words = (header.size + LNET_SNAPSHOT_WORD_SIZE - 1) / LNET_SNAPSHOT_WORD_SIZE;
+
+		std::vector<LNetByte> mask((words + 7) / 8);
+		message.readBytes(mask.data(), mask.size());
+
+		state.assign(baseline->begin(), baseline->end());
+
+		for (size_t word = 0; word < words; word++)
+		{
+			if (mask[word / 8] & (1 << (word % 8)))
+			{
+				size_t offset = word * LNET_SNAPSHOT_WORD_SIZE;
+				message.readBytes(state.data() + offset, std::min(LNET_SNAPSHOT_WORD_SIZE, state.size() - offset));
+			}
+		}
+	}
+}
@@ -0,0 +1,49 @@
+#ifndef LNET_SNAPSHOT_DELTA_HPP
+#define LNET_SNAPSHOT_DELTA_HPP
+
+#include <span>
+#include <vector>
+#include "LNetMessage.hpp"
+
+namespace lnet
+{
+	// Message types of the snapshot subsystem (SnapshotServer, SnapshotClient)
+	constexpr LNet2Byte LNET_TYPE_SNAPSHOT = 0xFFFB;
+	constexpr LNet2Byte LNET_TYPE_SNAPSHOT_ACK = 0xFFFA;
+
+	// Snapshots both sides remember, a baseline older than this is never used
+	constexpr size_t LNET_SNAPSHOT_HISTORY = 32;
+
+	// Baseline sequence of a full snapshot
+	constexpr LNet4Byte LNET_SNAPSHOT_NO_BASELINE = 0xFFFFFFFF;
+
+	// Granularity of a delta, one mask bit per word
+	constexpr size_t LNET_SNAPSHOT_WORD_SIZE = 4;
+
+	using SnapshotState = std::vector<LNetByte>;
+
+	// Snapshot encoding: [sequence][baseline sequence][state size] then either the whole state,
+	// or a bit per word of the state (set = changed since the baseline) followed by the changed words
+	class SnapshotDelta
+	{
+	public:
+		struct Header
+		{
+			LNet4Byte sequence = 0;
+			LNet4Byte baselineSequence = LNET_SNAPSHOT_NO_BASELINE;
+			LNet4Byte size = 0;
+		};
+
+		// Write the snapshot as a delta against the baseline, or whole when there is no baseline,
+		// its size differs, or the delta wouldn't be smaller
+		static void write(Message& message, const LNet4Byte& sequence, const LNet4Byte& baselineSequence,
+			const SnapshotState* baseline, std::span<const LNetByte> state);
+
+		static Header readHeader(Message& message);
+
+		// Read the state after the header, baseline is the snapshot the header names (nullptr for a whole snapshot)
+		static void readState(Message& message, const Header& header, const SnapshotState* baseline, SnapshotState& state);
+	};
+}
+
+#endif
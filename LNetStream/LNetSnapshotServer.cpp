@@ -0,0 +1,141 @@
+#include "LNetSnapshotServer.hpp"
+
+namespace lnet
+{
+	SnapshotServer::SnapshotServer(Server& server, const LNetByte& channel) :
+		server(server),
+		disconnectCallback(server.addDisconnectCallback([this](const LNet4Byte& clientID) { removeClient(clientID); })),
+		channel(channel),
+		nextSequence(0),
+		rateController(nullptr)
+	{
+		server.setMessageCallback({ channel, LNET_TYPE_SNAPSHOT_ACK },
+			[this](const LNet4Byte& clientID, Message& message) { handleAck(clientID, message); });
+	}
+
+	// Only send to the clients the controller says are due (nullptr sends to every listed client)
+
+	void SnapshotServer::setRateController(RateController* controller)
+	{
+		rateController = controller;
+	}
+
+	// Send the state to every listed client, clients that acknowledged the same baseline share one packet
+
+	void SnapshotServer::sendSnapshot(const std::vector<LNet4Byte>& allClientIDs, std::span<const LNetByte> state)
+	{
+		const std::vector<LNet4Byte> clientIDs = rateController ? rateController->filterDue(allClientIDs) : allClientIDs;
+		if (clientIDs.empty())
+		{
+			return;
+		}
+
+		const LNet4Byte sequence = nextSequence++;
+
+		// Kept once for every client it goes to
+		auto shared = std::make_shared<const SnapshotState>(state.begin(), state.end());
+
+		// baseline -> clients that have it
+		std::unordered_map<LNet4Byte, std::vector<LNet4Byte>> groups;
+
+		for (const LNet4Byte& clientID : clientIDs)
+		{
+			ClientHistory& history = histories[clientID];
+
+			groups[baselineOf(history, sequence)].push_back(clientID);
+
+			history.snapshots[sequence % LNET_SNAPSHOT_HISTORY] = { sequence, shared };
+		}
+
+		for (auto& [baselineSequence, group] : groups)
+		{
+			const SnapshotState* baseline = nullptr;
+			if (baselineSequence != LNET_SNAPSHOT_NO_BASELINE)
+			{
+				baseline = histories[group.front()].snapshots[baselineSequence % LNET_SNAPSHOT_HISTORY].state.get();
+			}
+
+			Message message(DeliveryMode::LatestOnly, channel, LNET_TYPE_SNAPSHOT);
+			SnapshotDelta::write(message, sequence, baselineSequence, baseline, state);
+
+			if (group.size() == 1)
+			{
+				server.sendClient(group.front(), message);
+			}
+			else
+			{
+				server.sendClients(group, message);
+			}
+		}
+	}
+
+	void SnapshotServer::sendSnapshot(const LNet4Byte& clientID, std::span<const LNetByte> state)
+	{
+		sendSnapshot(std::vector<LNet4Byte>{ clientID }, state);
+	}
+
+	// Forget a client's snapshots (done by the server's disconnects)
+
+	void SnapshotServer::removeClient(const LNet4Byte& clientID)
+	{
+		histories.erase(clientID);
+	}
+
+	SnapshotServer::~SnapshotServer()
+	{
+		server.removeMessageCallback({ channel, LNET_TYPE_SNAPSHOT_ACK });
+		server.removeDisconnectCallback(disconnectCallback);
+	}
+
+	/// <summary>
+	/// A client acknowledged a snapshot
+	/// </summary>
+	/// <param name="clientID"></param>
+	/// <param name="message"></param>
+
+	void SnapshotServer::handleAck(const LNet4Byte& clientID, Message& message)
+	{
+		// Remote input, a short ack is dropped rather than thrown out of tick()
+		if (message.getReadRemaining() < sizeof(LNet4Byte))
+		{
+			return;
+		}
+
+		LNet4Byte sequence;
+		message >> sequence;
+
+		auto history = histories.find(clientID);
+
+		// Unknown client, or a sequence that wasn't sent yet
+		if (history == histories.end() || static_cast<int32_t>(sequence - nextSequence) >= 0)
+		{
+			return;
+		}
+
+		if (!history->second.hasAck || static_cast<int32_t>(sequence - history->second.ackedSequence) > 0)
+		{
+			history->second.ackedSequence = sequence;
+			history->second.hasAck = true;
+		}
+	}
+
+	/// <summary>
+	/// The baseline the next snapshot can be encoded against, LNET_SNAPSHOT_NO_BASELINE when none
+	/// </summary>
+	/// <param name="history"></param>
+	/// <param name="sequence"></param>
+	/// <returns></returns>
+
+	LNet4Byte SnapshotServer::baselineOf(const ClientHistory& history, const LNet4Byte& sequence)
+	{
+		// The client only remembers the last LNET_SNAPSHOT_HISTORY snapshots too
+		if (!history.hasAck || sequence - history.ackedSequence >= LNET_SNAPSHOT_HISTORY)
+		{
+			return LNET_SNAPSHOT_NO_BASELINE;
+		}
+
+		const Snapshot& snapshot = history.snapshots[history.ackedSequence % LNET_SNAPSHOT_HISTORY];
+
+		return snapshot.sequence == history.ackedSequence && snapshot.state ? history.ackedSequence : LNET_SNAPSHOT_NO_BASELINE;
+	}
+}
@@ -0,0 +1,85 @@
+#ifndef LNET_SNAPSHOT_SERVER_HPP
+#define LNET_SNAPSHOT_SERVER_HPP
+
+#include <array>
+#include <memory>
+#include <unordered_map>
+#include "LNetRateController.hpp"
+#include "LNetServer.hpp"
+#include "LNetSnapshotDelta.hpp"
+
+namespace lnet
+{
+	// Sends world state snapshots delta encoded against the newest snapshot each client acknowledged,
+	// whole while a client has no usable baseline. Snapshots are LatestOnly messages on the given channel.
+	// Use it from the thread calling the server's tick() (the acks arrive through its callbacks)
+	class SnapshotServer
+	{
+	public:
+		SnapshotServer(Server& server, const LNetByte& channel = 0);
+
+		SnapshotServer(const SnapshotServer&) = delete;
+		SnapshotServer& operator=(const SnapshotServer&) = delete;
+
+		// Only send to the clients the controller says are due (nullptr sends to every listed client)
+		void setRateController(RateController* controller);
+
+		// Send the state to every listed client, clients that acknowledged the same baseline share one packet
+		void sendSnapshot(const std::vector<LNet4Byte>& clientIDs, std::span<const LNetByte> state);
+		void sendSnapshot(const LNet4Byte& clientID, std::span<const LNetByte> state);
+
+		// Forget a client's snapshots (done by the server's disconnects)
+		void removeClient(const LNet4Byte& clientID);
+
+		~SnapshotServer();
+
+	private:
+
+		struct Snapshot
+		{
+			LNet4Byte sequence = LNET_SNAPSHOT_NO_BASELINE;
+
+			// Shared by every client the snapshot went to
+			std::shared_ptr<const SnapshotState> state;
+		};
+
+		struct ClientHistory
+		{
+			std::array<Snapshot, LNET_SNAPSHOT_HISTORY> snapshots;
+
+			LNet4Byte ackedSequence = 0;
+			bool hasAck = false;
+		};
+
+		/// <summary>
+		/// A client acknowledged a snapshot
+		/// </summary>
+		/// <param name="clientID"></param>
+		/// <param name="message"></param>
+		void handleAck(const LNet4Byte& clientID, Message& message);
+
+		/// <summary>
+		/// The baseline the next snapshot can be encoded against, LNET_SNAPSHOT_NO_BASELINE when none
+		/// </summary>
+		/// <param name="history"></param>
+		/// <param name="sequence"></param>
+		/// <returns></returns>
+		static LNet4Byte baselineOf(const ClientHistory& history, const LNet4Byte& sequence);
+
+	private:
+
+		Server& server;
+
+		// Calls removeClient for every client that disconnects
+		LNet4Byte disconnectCallback;
+		LNetByte channel;
+
+		LNet4Byte nextSequence;
+
+		RateController* rateController;
+
+		std::unordered_map<LNet4Byte, ClientHistory> histories;
+	};
+}
+
+#endif
@@ -0,0 +1,113 @@
+#ifndef LNET_SPSC_QUEUE_HPP
+#define LNET_SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+namespace lnet
+{
+	// Cache line size, keeps the producer and consumer indices from sharing a line
+	constexpr size_t LNET_CACHE_LINE_SIZE = 64;
+
+	// Bounded lock free queue for exactly one producer thread and one consumer thread
+	template<typename T>
+	class SpscQueue
+	{
+	public:
+		// Capacity is rounded up to a power of 2
+		explicit SpscQueue(const size_t capacity = 1024);
+
+		SpscQueue(const SpscQueue&) = delete;
+		SpscQueue& operator=(const SpscQueue&) = delete;
+
+		// Producer only, returns false (and leaves value untouched) when the queue is full
+		bool push(T&& value);
+
+		// Consumer only, returns false when the queue is empty
+		bool pop(T& value);
+
+		// Either side, only a snapshot
+		bool empty() const;
+
+	private:
+		std::vector<T> slots;
+		size_t mask;
+
+		// Next slot to pop, written by the consumer
+		alignas(LNET_CACHE_LINE_SIZE) std::atomic<size_t> head;
+		// Last tail the consumer saw, saves reading the producer's line on every pop
+		size_t cachedTail;
+
+		// Next slot to push, written by the producer
+		alignas(LNET_CACHE_LINE_SIZE) std::atomic<size_t> tail;
+		// Last head the producer saw, saves reading the consumer's line on every push
+		size_t cachedHead;
+	};
+
+
+	template<typename T>
+	SpscQueue<T>::SpscQueue(const size_t capacity) :
+		head(0), cachedTail(0), tail(0), cachedHead(0)
+	{
+		size_t size = 2;
+		while (size < capacity)
+		{
+			size <<= 1;
+		}
+
+		slots.resize(size);
+		mask = size - 1;
+	}
+
+	template<typename T>
+	bool SpscQueue<T>::push(T&& value)
+	{
+		const size_t currentTail = tail.load(std::memory_order_relaxed);
+
+		if (currentTail - cachedHead == slots.size())
+		{
+			cachedHead = head.load(std::memory_order_acquire);
+
+			if (currentTail - cachedHead == slots.size())
+			{
+				return false;
+			}
+		}
+
+		slots[currentTail & mask] = std::move(value);
+		tail.store(currentTail + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	template<typename T>
+	bool SpscQueue<T>::pop(T& value)
+	{
+		const size_t currentHead = head.load(std::memory_order_relaxed);
+
+		if (currentHead == cachedTail)
+		{
+			cachedTail = tail.load(std::memory_order_acquire);
+
+			if (currentHead == cachedTail)
+			{
+				return false;
+			}
+		}
+
+		// The moved from slot is left empty, it doesn't keep what it held alive
+		value = std::move(slots[currentHead & mask]);
+		head.store(currentHead + 1, std::memory_order_release);
+
+		return true;
+	}
+
+	template<typename T>
+	bool SpscQueue<T>::empty() const
+	{
+		return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+	}
+}
+
+#endif
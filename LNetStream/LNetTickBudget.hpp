@@ -0,0 +1,37 @@
+#ifndef LNET_TICK_BUDGET_HPP
+#define LNET_TICK_BUDGET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace lnet
+{
+	// Most received messages kept waiting for their callback by default: no limit, nothing reliable is ever dropped
+	constexpr size_t LNET_DEFAULT_MAX_DEFERRED_MESSAGES = SIZE_MAX;
+
+	// How much of a tick may go to message callbacks, what doesn't fit waits for the next tick.
+	// Time counts from the start of the tick, servicing the host included, and isn't budgeted itself so enet's
+	// timing never suffers: a tick always calls at least one callback, so a slow service can't stall them for good.
+	// The default budget has no limit
+	struct TickBudget
+	{
+		// Most callbacks called, 0 for no limit
+		size_t maxMessages = 0;
+
+		// Most time spent, 0 for no limit (checked between callbacks, a slow callback can still overrun it)
+		std::chrono::microseconds maxTime{ 0 };
+
+		bool isExhausted(const size_t messagesHandled, const std::chrono::steady_clock::time_point& start) const
+		{
+			if (maxMessages != 0 && messagesHandled >= maxMessages)
+			{
+				return true;
+			}
+
+			return maxTime.count() != 0 && std::chrono::steady_clock::now() - start >= maxTime;
+		}
+	};
+}
+
+#endif
@@ -33,6 +33,8 @@ int main()
         {
             Server server(1000, 254);
 
+            // Only the first channels are used, don't have enet allocate all 254 for every client
+            server.setPhysicalChannels(4);
             server.listen(port);
 
 
@@ -46,6 +48,9 @@ int main()
                 }
             );
 
+            // The host is serviced on its own thread, tick() only calls the callbacks
+            server.startNetworkThread();
+
             while (isRunning.load())
             {
                 server.tick();
@@ -63,6 +68,7 @@ int main()
         [&]() 
         {
             Client client(254);
+            client.setPhysicalChannels(4);
          
             client.connect(port, "127.0.0.1");
 
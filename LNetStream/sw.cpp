@@ -0,0 +1,175 @@
+#include "LNetChecksum.hpp"
+#include <array>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	#define LNET_CRC32C_X86
+	#include <nmmintrin.h>
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define LNET_TARGET_SSE42
+	#else
+		#include <cpuid.h>
+		#define LNET_TARGET_SSE42 __attribute__((target("sse4.2")))
+	#endif
+#endif
+
+namespace lnet
+{
+	// Reflected CRC32C polynomial
+	constexpr LNet4Byte LNET_CRC32C_POLYNOMIAL = 0x82F63B78;
+
+	// tables[0] is the usual byte table, tables[k] advances a byte by k more zero bytes (slicing by 8)
+	static constexpr std::array<std::array<LNet4Byte, 256>, 8> makeCrc32cTables()
+	{
+		std::array<std::array<LNet4Byte, 256>, 8> tables{};
+
+		for (LNet4Byte byte = 0; byte < 256; byte++)
+		{
+			LNet4Byte crc = byte;
+			for (int bit = 0; bit < 8; bit++)
+			{
+				crc = (crc >> 1) ^ ((crc & 1) ? LNET_CRC32C_POLYNOMIAL : 0);
+			}
+			tables[0][byte] = crc;
+		}
+
+		for (size_t table = 1; table < 8; table++)
+		{
+			for (size_t byte = 0; byte < 256; byte++)
+			{
+				LNet4Byte previous = tables[table - 1][byte];
+				tables[table][byte] = (previous >> 8) ^ tables[0][previous & 0xFF];
+			}
+		}
+
+		return tables;
+	}
+
+	static constexpr std::array<std::array<LNet4Byte, 256>, 8> crc32cTables = makeCrc32cTables();
+
+	const bool Checksum::hardwareAccelerated = Checksum::detectHardware();
+
+	// ENetChecksumCallback, set as a host's checksum to have enet check every datagram (both ends must use it)
+
+	enet_uint32 ENET_CALLBACK Checksum::enetCallback(const ENetBuffer* buffers, size_t bufferCount)
+	{
+		LNet4Byte state = 0xFFFFFFFF;
+
+		for (size_t index = 0; index < bufferCount; index++)
+		{
+			const LNetByte* data = static_cast<const LNetByte*>(buffers[index].data);
+
+			state = false ?
+				updateHardware(state, data, buffers[index].dataLength) :
+				updateSoftware(state, data, buffers[index].dataLength);
+		}
+
+		// enet compares it as sent, in network order
+		return ENET_HOST_TO_NET_32(~state);
+	}
+
+	// CRC32C of the data, continues from crc when given the result over the data before it
+
+	LNet4Byte Checksum::crc32c(const void* data, const size_t length, const LNet4Byte crc)
+	{
+		const LNetByte* bytes = static_cast<const LNetByte*>(data);
+
+		LNet4Byte state = false ?
+			updateHardware(~crc, bytes, length) :
+			updateSoftware(~crc, bytes, length);
+
+		return ~state;
+	}
+
+	// Whether the crc32 instruction is used
+
+	bool Checksum::isHardwareAccelerated()
+	{
+		return hardwareAccelerated;
+	}
+
+	/// <summary>
+	/// Update a running (inverted) crc with the crc32 instruction
+	/// </summary>
+
+#ifdef LNET_CRC32C_X86
+	LNET_TARGET_SSE42
+	LNet4Byte Checksum::updateHardware(LNet4Byte state, const LNetByte* data, size_t length)
+	{
+	#if defined(_M_X64) || defined(__x86_64__)
+		uint64_t wide = state;
+		for (; length >= 8; data += 8, length -= 8)
+		{
+			uint64_t word;
+			std::memcpy(&word, data, sizeof(word));
+			wide = _mm_crc32_u64(wide, word);
+		}
+		state = static_cast<LNet4Byte>(wide);
+	#endif
+
+		for (; length >= 4; data += 4, length -= 4)
+		{
+			LNet4Byte word;
+			std::memcpy(&word, data, sizeof(word));
+			state = _mm_crc32_u32(state, word);
+		}
+
+		for (; length > 0; data++, length--)
+		{
+			state = _mm_crc32_u8(state, *data);
+		}
+
+		return state;
+	}
+#else
+	LNet4Byte Checksum::updateHardware(LNet4Byte state, const LNetByte* data, size_t length)
+	{
+		return updateSoftware(state, data, length);
+	}
+#endif
+
+	/// <summary>
+	/// Update a running (inverted) crc with the tables, 8 bytes per step
+	/// </summary>
+
+	LNet4Byte Checksum::updateSoftware(LNet4Byte state, const LNetByte* data, size_t length)
+	{
+		for (; length >= 8; data += 8, length -= 8)
+		{
+			// Byte by byte, so it doesn't depend on the machine's endianness
+			LNet4Byte low = state ^ (static_cast<LNet4Byte>(data[0]) | (static_cast<LNet4Byte>(data[1]) << 8) |
+				(static_cast<LNet4Byte>(data[2]) << 16) | (static_cast<LNet4Byte>(data[3]) << 24));
+
+			state = crc32cTables[7][low & 0xFF] ^ crc32cTables[6][(low >> 8) & 0xFF] ^
+				crc32cTables[5][(low >> 16) & 0xFF] ^ crc32cTables[4][low >> 24] ^
+				crc32cTables[3][data[4]] ^ crc32cTables[2][data[5]] ^
+				crc32cTables[1][data[6]] ^ crc32cTables[0][data[7]];
+		}
+
+		for (; length > 0; data++, length--)
+		{
+			state = (state >> 8) ^ crc32cTables[0][(state ^ *data) & 0xFF];
+		}
+
+		return state;
+	}
+
+	/// <summary>
+	/// Ask the cpu for SSE4.2
+	/// </summary>
+
+	bool Checksum::detectHardware()
+	{
+	#if defined(LNET_CRC32C_X86) && defined(_MSC_VER)
+		int registers[4];
+		__cpuid(registers, 1);
+		return (registers[2] & (1 << 20)) != 0;
+	#elif defined(LNET_CRC32C_X86)
+		unsigned int eax, ebx, ecx, edx;
+		return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2) != 0;
+	#else
+		return false;
+	#endif
+	}
+}